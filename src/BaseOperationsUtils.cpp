@@ -79,7 +79,8 @@ void BaseOperationsUtils::increment_base_x_integer(
         }
     }
 
+    // Like a number, the integer grows by a leading digit 1.
     if (carry) {
-        int_str.insert(int_str.begin(), '1');
+        int_str.insert(int_str.begin(), base_characters[1]);
     }
 }
@@ -0,0 +1,72 @@
+#include "CandidateOdometer.h"
+
+#include <iostream>
+
+CandidateOdometer::CandidateOdometer(std::string_view base_characters) :
+    CandidateOdometer(Mask::from_charset(base_characters))
+{
+}
+
+CandidateOdometer::CandidateOdometer(const Mask &mask) : m_max_size(mask.size())
+{
+    for (const auto &mask_charset : mask.get_charsets()) {
+        auto &charset = m_charsets.emplace_back();
+        charset.digit_of_character.fill(invalid_digit);
+
+        const size_t base = mask_charset.size();
+        charset.max_digit = static_cast<uint8_t>(base - 1);
+        for (size_t digit = 0; digit < base; ++digit) {
+            charset.characters[digit] = mask_charset[digit];
+            charset.next_digit[digit] = static_cast<uint8_t>((digit + 1) % base);
+            charset.digit_of_character[static_cast<uint8_t>(mask_charset[digit])] =
+                static_cast<uint8_t>(digit);
+        }
+    }
+
+    for (size_t position = 0; position < m_max_size; ++position) {
+        m_position_charsets[position] = static_cast<uint8_t>(mask.get_charset_index(position));
+    }
+}
+
+bool CandidateOdometer::set(std::string_view candidate)
+{
+    if (candidate.size() > m_max_size) {
+        std::cerr << "Candidate " << candidate << " is longer than " << m_max_size << "\n";
+        return false;
+    }
+
+    for (size_t position = 0; position < candidate.size(); ++position) {
+        const auto character = static_cast<uint8_t>(candidate[position]);
+        if (_get_charset(position).digit_of_character[character] == invalid_digit) {
+            std::cerr << "Candidate " << candidate << " has an invalid character '"
+                      << candidate[position] << "' at position " << position << "\n";
+            return false;
+        }
+    }
+
+    for (size_t position = 0; position < candidate.size(); ++position) {
+        const auto character   = static_cast<uint8_t>(candidate[position]);
+        m_digits[position]     = _get_charset(position).digit_of_character[character];
+        m_characters[position] = candidate[position];
+    }
+    m_size               = candidate.size();
+    m_characters[m_size] = '\0';
+
+    return true;
+}
+
+void CandidateOdometer::_grow()
+{
+    if (m_size == m_max_size) {
+        std::cerr << "Candidate exceeded the maximal length " << m_max_size << ", wrap around\n";
+        m_size          = 0;
+        m_characters[0] = '\0';
+        return;
+    }
+
+    // All the digits are 0, the first candidate of the next length has one more 0 digit.
+    m_digits[m_size]     = 0;
+    m_characters[m_size] = _get_charset(m_size).characters[0];
+    ++m_size;
+    m_characters[m_size] = '\0';
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "Mask.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The CandidateOdometer enumerates password candidates by length, and the candidates of the
+ * same length as fixed width base X integers, where the base characters are the valid characters,
+ * e.g. with "0123456789abcdefghijklmnopqrstuvwxyz":
+ * "", "0", "1", ..., "z", "00", "01", ..., "zz", "000", ...
+ *
+ * @details Each position may have its own charset (see Mask), for a mask attack. The enumeration
+ * is the order of the Keyspace indices. The odometer is designed to be called for every candidate:
+ * - The candidate is kept both as digits (indices of the characters) and as rendered characters,
+ *   so no character is searched in the base characters.
+ * - A digit is incremented with the carry table of its position charset, which gives the next
+ *   digit and wraps to 0.
+ * - The candidate is kept in fixed size arrays, so no memory is allocated.
+ * - The increment returns the position of the leftmost changed character, so the caller can copy
+ *   only the characters which changed.
+ * - Most increments change only the last character. The caller can generate a run of them at
+ *   once, see @a get_last_character_run().
+ *
+ * @example
+ *
+ * CandidateOdometer odometer("0123456789");
+ * odometer.set("98");
+ * odometer.increment(); // "99", returns 1
+ * odometer.increment(); // "000", returns 0
+ */
+
+class CandidateOdometer {
+  public:
+    /**
+     * @brief Maximal length of a candidate.
+     */
+    static constexpr size_t max_size = Mask::max_size;
+
+    /**
+     * @brief Construct a new CandidateOdometer object, set to the empty candidate.
+     *
+     * @param base_characters Characters of the base, at least 2 and at most 256 unique characters.
+     */
+    explicit CandidateOdometer(std::string_view base_characters);
+
+    /**
+     * @brief Construct a new CandidateOdometer object, set to the empty candidate. The candidates
+     * are at most as long as @a mask.
+     *
+     * @param mask Charset of each position.
+     */
+    explicit CandidateOdometer(const Mask &mask);
+
+    /**
+     * @brief Set the current candidate.
+     *
+     * @param candidate New candidate.
+     * @return true on success, false if @a candidate is too long or has a character which is not in
+     * the charset of its position. The current candidate is unchanged on failure.
+     */
+    bool set(std::string_view candidate);
+
+    /**
+     * @brief Increment the candidate to the next one.
+     *
+     * @return size_t Position of the leftmost changed character. The size of the candidate
+     * changed only if it is 0.
+     */
+    size_t increment()
+    {
+        for (size_t position = m_size; position-- > 0;) {
+            const auto &charset    = _get_charset(position);
+            const uint8_t digit    = charset.next_digit[m_digits[position]];
+            m_digits[position]     = digit;
+            m_characters[position] = charset.characters[digit];
+
+            // No carry to the next position.
+            if (digit != 0) {
+                return position;
+            }
+        }
+
+        _grow();
+        return 0;
+    }
+
+    /**
+     * @brief Get the number of the next increments which change only the last character.
+     */
+    size_t get_last_character_run() const
+    {
+        return m_size ? _get_charset(m_size - 1).max_digit - m_digits[m_size - 1] : 0;
+    }
+
+    /**
+     * @brief Increment the candidate @a count times, where @a count is at most
+     * @a get_last_character_run(). Faster than calling @a increment() @a count times, since it
+     * updates the candidate only once.
+     */
+    void increment_last_character(size_t count)
+    {
+        const auto digit         = static_cast<uint8_t>(m_digits[m_size - 1] + count);
+        m_digits[m_size - 1]     = digit;
+        m_characters[m_size - 1] = _get_charset(m_size - 1).characters[digit];
+    }
+
+    /**
+     * @brief Get the charset of the last position of the current candidate, which must not be
+     * empty. The character of digit d is at index d.
+     */
+    std::string_view get_last_position_charset() const
+    {
+        const auto &charset = _get_charset(m_size - 1);
+        return {charset.characters.data(), charset.max_digit + size_t(1)};
+    }
+
+    /**
+     * @brief Get the digit of the last character of the current candidate, which must not be
+     * empty.
+     */
+    size_t get_last_digit() const { return m_digits[m_size - 1]; }
+
+    /**
+     * @brief Get the current candidate. The view is null terminated.
+     */
+    std::string_view get() const { return {m_characters.data(), m_size}; }
+
+    /**
+     * @brief Get the size of the current candidate.
+     */
+    size_t size() const { return m_size; }
+
+  private:
+    /**
+     * @brief Tables of a charset.
+     */
+    struct sCharset {
+        std::array<char, 256> characters;
+        uint8_t max_digit;
+
+        /**
+         * @brief Carry table, the digit following each digit.
+         */
+        std::array<uint8_t, 256> next_digit;
+
+        /**
+         * @brief The digit of each character, used only to set the candidate.
+         */
+        std::array<uint8_t, 256> digit_of_character;
+    };
+
+    const sCharset &_get_charset(size_t position) const
+    {
+        return m_charsets[m_position_charsets[position]];
+    }
+
+    /**
+     * @brief Carry out of the leftmost digit, all the digits are 0. The candidate grows by a 0
+     * digit, to the first candidate of the next length.
+     */
+    void _grow();
+
+    static constexpr uint8_t invalid_digit = 0xff;
+
+    /**
+     * @brief The distinct charsets, and the index of the charset of each position up to
+     * @a m_max_size.
+     */
+    std::vector<sCharset> m_charsets;
+    std::array<uint8_t, max_size> m_position_charsets;
+    size_t m_max_size;
+
+    std::array<uint8_t, max_size> m_digits;
+    std::array<char, max_size + 1> m_characters = {};
+    size_t m_size = 0;
+};
@@ -0,0 +1,59 @@
+#include "CpuFeatures.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <cpuid.h>
+#endif
+
+bool CpuFeatures::has_avx2() { return _get_features().avx2; }
+
+bool CpuFeatures::has_avx512f() { return _get_features().avx512f; }
+
+bool CpuFeatures::has_sha() { return _get_features().sha; }
+
+const CpuFeatures::sFeatures &CpuFeatures::_get_features()
+{
+    static const sFeatures features = []() {
+        sFeatures result;
+
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t eax, ebx, ecx, edx;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+            return result;
+        }
+
+        constexpr uint32_t sse41_bit = 1u << 19;
+        const bool sse41             = ecx & sse41_bit;
+
+        // The OS must enable XSAVE (OSXSAVE bit) for the XCR0 register to be readable.
+        constexpr uint32_t osxsave_bit = 1u << 27;
+        uint32_t xcr0_low = 0, xcr0_high;
+        if (ecx & osxsave_bit) {
+            __asm__("xgetbv" : "=a"(xcr0_low), "=d"(xcr0_high) : "c"(0));
+        }
+
+        // XMM and YMM state for AVX, and additionally opmask and ZMM state for AVX-512.
+        constexpr uint32_t avx_state_mask    = 0x06;
+        constexpr uint32_t avx512_state_mask = 0xe6;
+        const bool os_avx_support            = (xcr0_low & avx_state_mask) == avx_state_mask;
+        const bool os_avx512_support = (xcr0_low & avx512_state_mask) == avx512_state_mask;
+
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return result;
+        }
+
+        constexpr uint32_t avx2_bit    = 1u << 5;
+        constexpr uint32_t avx512f_bit = 1u << 16;
+        constexpr uint32_t sha_bit     = 1u << 29;
+
+        result.avx2    = os_avx_support && (ebx & avx2_bit);
+        result.avx512f = os_avx512_support && (ebx & avx512f_bit);
+        result.sha     = sse41 && (ebx & sha_bit);
+#endif
+
+        return result;
+    }();
+
+    return features;
+}
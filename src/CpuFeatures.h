@@ -0,0 +1,42 @@
+#pragma once
+
+/**
+ * @brief The CpuFeatures class reports which instruction set extensions are usable on the running
+ * CPU, so optimized code paths can be selected at runtime instead of at compile time.
+ *
+ * @details The detection is done once, on the first call, by querying CPUID. For the AVX families
+ * it also checks (using XGETBV) that the operating system saves the wide registers on context
+ * switch, otherwise the instructions are reported as unsupported.
+ */
+
+class CpuFeatures {
+  public:
+    /**
+     * @brief Returns true if the CPU and the OS support AVX2.
+     */
+    static bool has_avx2();
+
+    /**
+     * @brief Returns true if the CPU and the OS support AVX-512 Foundation.
+     */
+    static bool has_avx512f();
+
+    /**
+     * @brief Returns true if the CPU supports the SHA extensions (SHA-NI) and SSE4.1.
+     */
+    static bool has_sha();
+
+  private:
+    struct sFeatures {
+        bool avx2    = false;
+        bool avx512f = false;
+        bool sha     = false;
+    };
+
+    /**
+     * @brief Detect the CPU features.
+     *
+     * @return const sFeatures& The cached result of the detection.
+     */
+    static const sFeatures &_get_features();
+};
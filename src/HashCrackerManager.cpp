@@ -2,6 +2,7 @@
 
 #include "GlobalDefintions.h"
 
+#include <base64.h>
 #include <cassert>
 #include <iomanip>
 #include <iostream>
@@ -13,8 +14,29 @@ static constexpr std::string_view unsafe_operation_err =
 static constexpr std::string_view unnecessary_thread_safe_operation_warn =
     "Unnecessary thread safe operation\n";
 
-HashCrackerManager::HashCrackerManager(uint32_t id, uint32_t& discovered_passwords_count) :
-    m_id(id), m_hash_cracker(id, std::move(HashGenerator(salt, pepper, valid_chars))),
+/**
+ * @brief Construct the HashGenerator of the attack set in @a config.
+ */
+static HashGenerator make_hash_generator(const sHashCrackerConfig& config)
+{
+    if (config.wordlist && config.right_wordlist) {
+        return HashGenerator(salt, pepper, config.wordlist, config.right_wordlist);
+    }
+    if (config.wordlist && config.mask) {
+        return HashGenerator(salt, pepper, config.wordlist, *config.mask,
+            config.min_permutation_size, config.max_permutation_size, config.mask_position);
+    }
+    if (config.wordlist) {
+        return HashGenerator(salt, pepper, config.wordlist, config.rules);
+    }
+    return HashGenerator(salt, pepper, config.mask ? *config.mask : Mask::from_charset(valid_chars),
+        config.min_permutation_size, config.max_permutation_size);
+}
+
+HashCrackerManager::HashCrackerManager(
+    uint32_t id, uint32_t& discovered_passwords_count, const sHashCrackerConfig& config) :
+    m_id(id),
+    m_hash_cracker(id, make_hash_generator(config), config),
     m_msg_endpoint(m_hash_cracker.get_external_endpoint()),
     m_discovered_passwords_count(discovered_passwords_count)
 {
@@ -22,8 +44,7 @@ HashCrackerManager::HashCrackerManager(uint32_t id, uint32_t& discovered_passwor
 }
 
 void HashCrackerManager::init(
-    const std::vector<std::shared_ptr<HashCrackerManager>>& other_thread_managers,
-    std::vector<std::string_view>& hash_list, HashCrackerManager* main_thread_manager)
+    std::shared_ptr<TargetSet> target_set, std::shared_ptr<KeyspaceScheduler> keyspace_scheduler)
 {
     if (m_is_initialized) {
         std::cerr << "HashCrackerManager " << m_id << " is already initialized\n";
@@ -31,15 +52,6 @@ void HashCrackerManager::init(
         return;
     }
 
-    if (main_thread_manager) {
-        m_main_thread_manager = main_thread_manager;
-    }
-
-    // Insert to the list only other HashCrackerManagers that runs their thread
-    std::copy_if(other_thread_managers.begin(), other_thread_managers.end(),
-        std::back_inserter(m_other_thread_managers),
-        [&](const auto& hash_cracker) { return hash_cracker->m_id != m_id; });
-
     // Initialize the main thread, the other thread will automatically be initialized when
     // the their thread will start.
     if (m_id == 0) {
@@ -47,7 +59,11 @@ void HashCrackerManager::init(
     }
 
     // Set the hash list
-    m_hash_cracker.set_hash_list(hash_list);
+    m_hash_cracker.set_target_set(std::move(target_set));
+
+    if (keyspace_scheduler) {
+        m_hash_cracker.set_keyspace_scheduler(std::move(keyspace_scheduler));
+    }
 
     m_is_initialized = true;
 }
@@ -88,21 +104,21 @@ void HashCrackerManager::handle_messages_thread_safe()
     m_msg_endpoint.handle_messages_thread_safe();
 }
 
-void HashCrackerManager::send_message(std::unique_ptr<MsgBase>&& message)
+void HashCrackerManager::send_message(const sMessageSlot& message)
 {
     if (m_id > 0) {
         std::cerr << unsafe_operation_err;
         assert(true);
     }
-    m_msg_endpoint.send_message(std::move(message));
+    m_msg_endpoint.send_message(message);
 }
 
-void HashCrackerManager::send_message_thread_safe(std::unique_ptr<MsgBase>&& message)
+void HashCrackerManager::send_message_thread_safe(const sMessageSlot& message)
 {
     if (m_id == 0) {
         std::cout << unnecessary_thread_safe_operation_warn;
     }
-    m_msg_endpoint.send_message_thread_safe(std::move(message));
+    m_msg_endpoint.send_message_thread_safe(message);
 }
 
 void HashCrackerManager::_register_message_handlers()
@@ -111,38 +127,33 @@ void HashCrackerManager::_register_message_handlers()
 
     // HASH_DISCOVERY Handler
     m_msg_endpoint.register_message_handler(
-        eMessageType::HASH_DISCOVERY, [&](std::unique_ptr<MsgBase>&& message) {
-            auto msg = static_cast<sMSG_HASH_DISCOVERY*>(message.get());
-            std::cout << "HashCrackerThread " << msg->id
-                      << " cracked hash str: " << std::quoted(msg->permutation)
-                      << " hash: " << std::quoted(msg->hash) << "\n\n";
+        eMessageType::HASH_DISCOVERY, [&](const MsgBase& message) {
+            auto msg = static_cast<const sMSG_HASH_DISCOVERY*>(&message);
 
-            ++m_discovered_passwords_count;
-
-            for (auto& thread_manager : m_other_thread_managers) {
-                auto msg_out = std::make_unique<sMSG_REMOVE_HASH_FROM_LIST>(msg->hash);
-                thread_manager->send_message_thread_safe(std::move(msg_out));
+            // Reassemble the permutation from its parts, which arrive in order.
+            if (msg->part_offset == 0) {
+                m_discovered_permutation.clear();
             }
-
-            // If this is not the main thread manager, send it to it as well
-            if (m_id > 0) {
-                if (!m_main_thread_manager) {
-                    std::cerr << "main thread manager is null\n";
-                    assert(true);
-                    return;
-                }
-                auto msg_out = std::make_unique<sMSG_REMOVE_HASH_FROM_LIST>(msg->hash);
-                m_main_thread_manager->m_msg_endpoint.send_message(std::move(msg_out));
+            m_discovered_permutation.append(msg->permutation_part.data(), msg->part_size);
+            if (!msg->is_last_part()) {
+                return;
             }
+
+            std::cout << "HashCrackerThread " << msg->id
+                      << " cracked hash str: " << std::quoted(m_discovered_permutation) << " hash: "
+                      << std::quoted(base64_encode(msg->digest.data(), msg->digest.size()))
+                      << "\n\n";
+
+            ++m_discovered_passwords_count;
         });
 
     // FINISHED_TASK Handler
     m_msg_endpoint.register_message_handler(
-        eMessageType::FINISHED_TASK, [&](std::unique_ptr<MsgBase>&& message) {
-            auto msg = static_cast<sMSG_FINISHED_TASK*>(message.get());
+        eMessageType::FINISHED_TASK, [&](const MsgBase& message) {
+            auto msg = static_cast<const sMSG_FINISHED_TASK*>(&message);
             std::cout << "Hash Cracker with ID " << msg->worker_id << " finished the task\n";
 
-            // TODO: Change this behaviour in the future
+            // With a keyspace scheduler, there is nothing left to steal from the other threads.
             if (m_id > 0) {
                 m_hash_cracker.get_thread().stop_thread();
             }
@@ -151,10 +162,11 @@ void HashCrackerManager::_register_message_handlers()
 
     // HASH_RATE_UPDATE Handler
     m_msg_endpoint.register_message_handler(
-        eMessageType::HASH_RATE_UPDATE, [&](std::unique_ptr<MsgBase>&& message) {
-            auto msg = static_cast<sMSG_HASH_RATE_UPDATE*>(message.get());
+        eMessageType::HASH_RATE_UPDATE, [&](const MsgBase& message) {
+            auto msg = static_cast<const sMSG_HASH_RATE_UPDATE*>(&message);
             // std::cout << "Hash Cracker with ID " << msg->worker_id
             //           << " updated rate: " << msg->rate << "\n";
-            m_hash_rate = msg->rate;
+            m_hash_rate                     = msg->rate;
+            m_prefilter_false_positive_rate = msg->prefilter_false_positive_rate;
         });
 }
@@ -13,20 +13,21 @@ class HashCrackerManager {
      * @param id ID of the HashCrackerThread, value of '0' shall be used only if not running the
      * The HashCrackerThread in a new thread context.
      * @param discovered_passwords_count Counter of discovered password.
+     * @param config Configuration of the HashCrackerThread.
      */
-    HashCrackerManager(uint32_t id, uint32_t& discovered_passwords_count);
+    HashCrackerManager(uint32_t id, uint32_t& discovered_passwords_count,
+        const sHashCrackerConfig& config = {});
 
     /**
      * @brief Initialize the HashCrackerManager.
      *
-     * @param other_thread_managers A vector filled with hash cracker managers.
-     * @param hash_list Hash list.
-     * @param main_thread_manager The main thread HashCrackerManager that runs in the main thread
-     * context. [Optional]
+     * @param target_set Hash list, shared by all the hash cracker managers. A hash cracked by one
+     * HashCrackerThread is marked in it, so the others stop looking for it without any message.
+     * @param keyspace_scheduler Keyspace scheduler shared by all the hash cracker managers, the
+     * HashCrackerThread takes its tasks from it. If null, the tasks are set by SET_TASK messages.
      */
-    void init(const std::vector<std::shared_ptr<HashCrackerManager>>& other_thread_managers,
-        std::vector<std::string_view>& hash_list,
-        HashCrackerManager* main_thread_manager = nullptr);
+    void init(std::shared_ptr<TargetSet> target_set,
+        std::shared_ptr<KeyspaceScheduler> keyspace_scheduler = nullptr);
 
     /**
      * @brief Get the thread object, of the internal HashCrackerThread to allow controlling the
@@ -63,8 +64,8 @@ class HashCrackerManager {
      * @warning The upper function is not thread safe and shall be called only on the object running
      * on the main thread context, i.e. ID = 0.
      */
-    void send_message(std::unique_ptr<MsgBase>&& message);
-    void send_message_thread_safe(std::unique_ptr<MsgBase>&& message);
+    void send_message(const sMessageSlot& message);
+    void send_message_thread_safe(const sMessageSlot& message);
 
     /**
      * @brief Get the latest hash rate received from the internal HashCrackerThread.
@@ -73,6 +74,17 @@ class HashCrackerManager {
      */
     inline uint64_t get_hash_rate() const { return m_hash_rate; }
 
+    /**
+     * @brief Get the latest prefilter false positive rate received from the internal
+     * HashCrackerThread.
+     *
+     * @return double False positive rate, negative if the prefilter is not in use.
+     */
+    inline double get_prefilter_false_positive_rate() const
+    {
+        return m_prefilter_false_positive_rate;
+    }
+
   private:
     /**
      * @brief Register message handlers for the internal HashCrackerThread.
@@ -85,12 +97,14 @@ class HashCrackerManager {
     HashCrackerThread m_hash_cracker;
     MsgExternalEndPoint& m_msg_endpoint;
 
-    /* Reference to other managers */
-    HashCrackerManager* m_main_thread_manager;
-    std::vector<std::shared_ptr<HashCrackerManager>> m_other_thread_managers;
-
     /* Status Variables */
     uint32_t& m_discovered_passwords_count;
-    uint64_t m_hash_rate  = -1;
-    bool m_is_initialized = false;
+    uint64_t m_hash_rate                   = -1;
+    double m_prefilter_false_positive_rate = -1;
+    bool m_is_initialized                  = false;
+
+    /**
+     * @brief The parts of the permutation of the latest HASH_DISCOVERY received so far.
+     */
+    std::string m_discovered_permutation;
 };
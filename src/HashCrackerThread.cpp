@@ -1,29 +1,24 @@
 #include "HashCrackerThread.h"
 
-#include "BaseOperationsUtils.h"
-
 #include <algorithm>
-#include <base64.h>
 #include <iomanip>
 #include <iostream>
 
-HashCrackerThread::HashCrackerThread(uint32_t id, HashGenerator &&hash_generator) :
-    m_id(id), m_thread("HashCrackerThread::" + std::to_string(m_id),
+HashCrackerThread::HashCrackerThread(
+    uint32_t id, HashGenerator &&hash_generator, const sHashCrackerConfig &config) :
+    m_id(id), m_config(config), m_thread("HashCrackerThread::" + std::to_string(m_id),
                   std::bind(&HashCrackerThread::loop, this),
-                  std::bind(&HashCrackerThread::_thread_init, this)),
-    m_hash_generator(std::move(hash_generator)), m_statistics(),
+                  std::bind(&HashCrackerThread::_thread_init, this),
+                  [this]() { m_io.get_external_endpoint().wake_up(); }),
+    m_hash_generator(std::move(hash_generator)), m_statistics(), m_io(config.message_transport),
     m_message_endpoint(m_io.get_internal_endpoint())
 
 {
     std::cout << m_thread.get_thread_name() << " created!\n";
 
     /* Define Message Handlers */
-    m_message_endpoint.register_message_handler(eMessageType::SET_TASK,
-        std::bind(&HashCrackerThread::_msg_handler_set_task, this, std::placeholders::_1));
-
-    m_message_endpoint.register_message_handler(eMessageType::REMOVE_HASH_FROM_LIST,
-        std::bind(
-            &HashCrackerThread::_msg_handler_remove_hash_from_list, this, std::placeholders::_1));
+    m_message_endpoint.register_message_handler(
+        eMessageType::SET_TASK, [this](const MsgBase &message) { _msg_handler_set_task(message); });
 }
 
 bool HashCrackerThread::_thread_init() { return init(); }
@@ -34,26 +29,22 @@ bool HashCrackerThread::init()
     m_scheduler.schedule_task(std::string(m_thread.get_thread_name()) + " hash rate update",
         std::bind(&HashCrackerThread::_send_hash_rate_update, this), std::chrono::seconds(1));
 
-    /* Schedule periodic message receive and handling, and set the relevant send function */
+    /* Set the relevant message handling and send functions */
 
     // If running the class in thread context use the thread safe functions, otherwise use the
     // regular functions.
     if (m_thread.is_thread_running()) {
-        m_scheduler.schedule_task(std::string(m_thread.get_thread_name()) + " handle messages",
-            std::bind(&MsgInternalEndPoint::handle_messages_thread_safe, &m_message_endpoint),
-            std::chrono::seconds(1));
+        _handle_messages = [&]() { m_message_endpoint.handle_messages_thread_safe(); };
 
-        _send_message = [&](std::unique_ptr<MsgBase> &&msg) {
-            m_message_endpoint.send_message_thread_safe(std::move(msg));
+        _send_message = [&](const sMessageSlot &msg) {
+            m_message_endpoint.send_message_thread_safe(msg);
         };
 
     } else {
-        m_scheduler.schedule_task(std::string(m_thread.get_thread_name()) + " handle messages",
-            std::bind(&MsgInternalEndPoint::handle_messages, &m_message_endpoint),
-            std::chrono::seconds(1));
+        _handle_messages = [&]() { m_message_endpoint.handle_messages(); };
 
-        _send_message = [&](std::unique_ptr<MsgBase> &&msg) {
-            m_message_endpoint.send_message(std::move(msg));
+        _send_message = [&](const sMessageSlot &msg) {
+            m_message_endpoint.send_message(msg);
         };
     }
 
@@ -65,51 +56,32 @@ MsgExternalEndPoint &HashCrackerThread::get_external_endpoint()
     return m_io.get_external_endpoint();
 }
 
-void HashCrackerThread::set_hash_list(const std::vector<std::string_view> &encrypted_password_list)
+void HashCrackerThread::set_target_set(std::shared_ptr<TargetSet> target_set)
 {
-    /* Base64 decode the given hash list */
-    m_hash_map.reserve(encrypted_password_list.size());
-    for (auto hash_sv : encrypted_password_list) {
-        std::string hash_str(hash_sv);
-
-        // I'm not sure why, but the creator of the base64 library designed the decode function to
-        // return an array of uint8_t values encapsulated in a std::string instead of an array or a
-        // vector. The result is obviously non-printable since it contains many non-printable
-        // characters.
-        // Since the SHA256 library returns a printable string of uint8_t values in hexadecimal
-        // format, we need to transform the output of the base64_decode() function to a string of
-        // hexadecimal values.
-
-        auto b64_decoded_uint8s = base64_decode(hash_str);
-        std::string b64_decoded_hash;
-
-        // 64 is the number bytes in SHA-256 multiplied by 2, since each byte represented by two
-        // characters.
-        b64_decoded_hash.reserve(64);
-
-        // Transform each uint8_t in the b64_decoded_uint8s string into two hexadecimal printable
-        // characters.
-        for (auto c : b64_decoded_uint8s) {
-            constexpr std::string_view base_characters_16 = "0123456789abcdef";
-            auto hex =
-                BaseOperationsUtils::decimal_to_base_x(static_cast<uint8_t>(c), base_characters_16);
+    m_target_set = std::move(target_set);
 
-            // Pad with single '0' if there is a single character.
-            hex.insert(0, hex.size() & 1, '0');
-            b64_decoded_hash.append(hex);
-        }
-
-        // Push the base64 decoded hash to vector that maps the decoded hash to the non decoded hash
-        m_hash_map.emplace_back(std::move(sHashDict {hash_str, b64_decoded_hash}));
+    if (m_config.prefilter_bits_log2) {
+        m_prefilter_cracked_count = m_target_set->get_cracked_count();
+        m_prefilter.emplace(m_config.prefilter_bits_log2, *m_target_set);
     }
 
-    // Sort the hash map to allow binary search on it.
-    std::sort(m_hash_map.begin(), m_hash_map.end(),
-        [](const sHashDict &a, const sHashDict &b) { return a.decoded_hash < b.decoded_hash; });
+    _update_target_filters();
+}
+
+void HashCrackerThread::set_keyspace_scheduler(
+    std::shared_ptr<KeyspaceScheduler> keyspace_scheduler)
+{
+    m_keyspace_scheduler = std::move(keyspace_scheduler);
+    m_keyspace_exhausted = false;
 }
 
 void HashCrackerThread::loop()
 {
+    // Handle the incoming messages as soon as they arrive, the check is a single load per batch.
+    if (m_message_endpoint.has_pending_messages()) {
+        _handle_messages();
+    }
+
     // Do scheduled tasks
     m_scheduler.poll();
 
@@ -119,65 +91,250 @@ void HashCrackerThread::loop()
 
 void HashCrackerThread::_work()
 {
-    if (m_finished_current_task) {
+    if (m_finished_current_task && !_start_next_chunk()) {
+        // Idle until a message arrives, e.g. a new task, or until the thread is stopped.
         if (m_thread.is_thread_running()) {
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            m_message_endpoint.wait_for_messages(sHashCrackerConfig::idle_timeout);
         }
         return;
     }
 
-    auto b64_decoded_hash = m_hash_generator.get_next_permutation_hash();
+    // Hashes cracked by other threads since the last batch change the remaining hashes.
+    if (m_target_set->get_cracked_count() != m_target_set_cracked_count) {
+        _update_target_filters();
+    }
 
-    auto iter_opt = _find_hash_encrypted_password_list(b64_decoded_hash);
+    // In a wordlist attack, the next word may start after the end of the task.
+    const auto max_count = m_next_index < m_end_index ? m_end_index - m_next_index : 0;
+
+    if (m_early_reject_enabled) {
+        auto batch_size = m_hash_generator.next_early_reject_words(m_hash_batch, max_count);
+
+        for (size_t i = 0; i < batch_size; ++i) {
+            const auto word      = m_hash_batch.early_reject_words[i];
+            const bool may_match = m_scanner_enabled
+                                       ? m_scanner.contains(word)
+                                       : std::binary_search(m_early_reject_words.begin(),
+                                             m_early_reject_words.end(), word);
+            if (!may_match) {
+                continue;
+            }
+
+            // Rare case, the candidate may match a known hash.
+            _check_hash(m_hash_generator.complete_hash(m_hash_batch, i),
+                m_hash_batch.permutations[i]);
+        }
 
-    // Continue if the hash if not in the list.
-    if (iter_opt) {
-        // Notify to others about the discovered hash, so they will remove it also from the
-        // list.
-        _send_hash_discovery((*iter_opt)->encoded_hash, m_hash_generator.get_current_permutation());
+        m_permutation_counter += batch_size;
 
-        // Remove the discovered hash from the list.
-        m_hash_map.erase(*iter_opt);
+    } else {
+        auto batch_size = m_hash_generator.next_hashes(m_hash_batch, max_count);
+
+        if (m_scanner_enabled) {
+            for (size_t i = 0; i < batch_size; ++i) {
+                if (m_scanner.contains(TargetScanner::get_digest_key(m_hash_batch.hashes[i]))) {
+                    _check_hash(m_hash_batch.hashes[i], m_hash_batch.permutations[i]);
+                }
+            }
+
+        } else if (m_prefilter) {
+            // Prefetch the hash list buckets of the candidates which pass the prefilter, and look
+            // them up in a second pass, so the memory latency of the lookups overlaps.
+            std::array<uint8_t, sHashBatch::capacity> candidates;
+            size_t candidates_count = 0;
+            for (size_t i = 0; i < batch_size; ++i) {
+                if (m_prefilter->may_contain(m_hash_batch.hashes[i])) {
+                    m_target_set->prefetch(m_hash_batch.hashes[i]);
+                    candidates[candidates_count++] = static_cast<uint8_t>(i);
+                }
+            }
+
+            for (size_t i = 0; i < candidates_count; ++i) {
+                const auto candidate = candidates[i];
+                if (!_check_hash(
+                        m_hash_batch.hashes[candidate], m_hash_batch.permutations[candidate])) {
+                    ++m_prefilter_false_positives_counter;
+                }
+            }
+            m_prefilter_checks_counter += batch_size;
+
+        } else {
+            std::array<TargetSet::sMatch, sHashBatch::capacity> matches;
+            auto matches_count =
+                m_target_set->find_batch(m_hash_batch.hashes.data(), batch_size, matches.data());
+
+            for (size_t i = 0; i < matches_count; ++i) {
+                _report_match(
+                    matches[i].target_index, m_hash_batch.permutations[matches[i].digest_index]);
+            }
+        }
+
+        m_permutation_counter += batch_size;
     }
-    ++m_permutation_counter;
 
-    if (m_permutation_counter == m_max_permutations) {
+    m_next_index = m_hash_generator.get_next_index();
+    if (m_next_index >= m_end_index) {
         m_finished_current_task = true;
+        if (m_current_chunk) {
+            _complete_chunk();
+        } else {
+            _send_finished_task();
+        }
+    }
+}
+
+bool HashCrackerThread::_start_next_chunk()
+{
+    if (!m_keyspace_scheduler || m_keyspace_exhausted) {
+        return false;
+    }
+
+    m_current_chunk = m_keyspace_scheduler->next_chunk(m_id, m_chunk_size);
+    if (!m_current_chunk) {
+        // Nothing left to steal either, the whole keyspace is scheduled.
+        m_keyspace_exhausted = true;
         _send_finished_task();
+        return false;
     }
+
+    if (!m_hash_generator.set_next_index(m_current_chunk->begin)) {
+        std::cerr << m_thread.get_thread_name() << " Invalid chunk [" << m_current_chunk->begin
+                  << ", " << m_current_chunk->end << ")\n";
+        m_keyspace_scheduler->complete_chunk(*m_current_chunk);
+        m_current_chunk.reset();
+        return false;
+    }
+
+    m_next_index            = m_hash_generator.get_next_index();
+    m_end_index             = m_current_chunk->end;
+    m_finished_current_task = false;
+    m_chunk_start_time      = std::chrono::steady_clock::now();
+    return true;
+}
+
+void HashCrackerThread::_complete_chunk()
+{
+    m_keyspace_scheduler->complete_chunk(*m_current_chunk);
+
+    // Size the next chunk to take about chunk_duration at the rate measured on this one. The
+    // change is bounded, so a single preempted chunk doesn't shrink the next one too much.
+    const auto chunk_size = m_current_chunk->end - m_current_chunk->begin;
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - m_chunk_start_time;
+    const std::chrono::duration<double> chunk_duration = sHashCrackerConfig::chunk_duration;
+
+    const double target_size =
+        elapsed.count() > 0 ? chunk_size * (chunk_duration / elapsed) : 2.0 * m_chunk_size;
+    m_chunk_size = std::clamp(
+        static_cast<uint64_t>(target_size), m_chunk_size / 2, m_chunk_size * 2);
+    m_chunk_size = std::max(m_chunk_size, sHashCrackerConfig::min_chunk_size);
+
+    m_current_chunk.reset();
 }
 
 Thread &HashCrackerThread::get_thread() { return m_thread; }
 
-const std::optional<HashCrackerThread::VectorOfHashDictIterator>
-HashCrackerThread::_find_hash_encrypted_password_list(std::string_view b64_decoded_hash) const
+bool HashCrackerThread::_check_hash(
+    const Sha256Engine::Digest &digest, std::string_view permutation)
 {
-    /**
-     * @details There were several implementation options.
-     * 1. Using Vector or Set/Unordered Set
-     * For the small amount of data in the container this project will use, vector is the fastest.
-     * 2. For lookup in the Vector, we can use std::find(), or binary seach using std::lower_bound.
-     * Both options gave equivalent performance. Used the binary search eventually though it is
-     * requireing a sorted container since it iterate on less elements in total.
-     */
+    auto index = m_target_set->find(digest);
+
+    // Continue if the hash if not in the list.
+    if (!index) {
+        return false;
+    }
 
-    auto found_iter = std::lower_bound(m_hash_map.begin(), m_hash_map.end(), b64_decoded_hash,
-        [](const sHashDict &hash_dict, const std::string_view decoded_hash) {
-            return hash_dict.decoded_hash < decoded_hash;
-        });
+    _report_match(*index, permutation);
+    return true;
+}
 
-    if (found_iter != m_hash_map.end() && b64_decoded_hash == found_iter->decoded_hash) {
-        return found_iter;
+void HashCrackerThread::_report_match(size_t target_index, std::string_view permutation)
+{
+    // Another thread may have cracked the same hash concurrently, only the first one reports it.
+    if (!m_target_set->mark_cracked(target_index)) {
+        return;
     }
 
-    return std::nullopt;
+    _send_hash_discovery(m_target_set->get_digest(target_index), permutation);
+    _update_target_filters();
+}
+
+void HashCrackerThread::_update_target_filters()
+{
+    m_target_set_cracked_count = m_target_set->get_cracked_count();
+
+    _update_early_reject_words();
+    _update_prefilter();
+    _update_scanner();
+}
+
+void HashCrackerThread::_update_early_reject_words()
+{
+    const auto remaining_hashes = m_target_set->size() - m_target_set_cracked_count;
+    m_early_reject_enabled =
+        m_config.early_reject && remaining_hashes <= sHashCrackerConfig::early_reject_max_hashes;
+
+    m_early_reject_words.clear();
+    if (!m_early_reject_enabled) {
+        return;
+    }
+
+    for (size_t i = 0; i < m_target_set->size(); ++i) {
+        if (m_target_set->is_cracked(i)) {
+            continue;
+        }
+        m_early_reject_words.push_back(
+            Sha256Engine::get_early_reject_word(m_target_set->get_digest(i)));
+    }
+    std::sort(m_early_reject_words.begin(), m_early_reject_words.end());
+}
+
+void HashCrackerThread::_update_prefilter()
+{
+    if (!m_prefilter) {
+        return;
+    }
+
+    // Rebuilding the prefilter costs a pass over the whole list, so tolerate some false positives
+    // of cracked hashes before rebuilding it.
+    const auto remaining_hashes = m_target_set->size() - m_target_set_cracked_count;
+    const auto stale_hashes     = m_target_set_cracked_count - m_prefilter_cracked_count;
+    if (stale_hashes * sHashCrackerConfig::prefilter_rebuild_ratio <= remaining_hashes) {
+        return;
+    }
+
+    m_prefilter->build(*m_target_set);
+    m_prefilter_cracked_count = m_target_set_cracked_count;
+}
+
+void HashCrackerThread::_update_scanner()
+{
+    const auto remaining_hashes = m_target_set->size() - m_target_set_cracked_count;
+    m_scanner_enabled           = remaining_hashes <= TargetScanner::max_keys;
+    if (!m_scanner_enabled) {
+        return;
+    }
+
+    // The early reject words are already built from the remaining hashes.
+    if (m_early_reject_enabled) {
+        m_scanner.set_keys(m_early_reject_words);
+        return;
+    }
+
+    std::vector<uint32_t> keys;
+    for (size_t i = 0; i < m_target_set->size(); ++i) {
+        if (!m_target_set->is_cracked(i)) {
+            keys.push_back(TargetScanner::get_digest_key(m_target_set->get_digest(i)));
+        }
+    }
+    m_scanner.set_keys(keys);
 }
 
 /**************************************************************************************************/
 /* Message Handlers                                                                               */
 /**************************************************************************************************/
 
-void HashCrackerThread::_msg_handler_set_task(std::unique_ptr<MsgBase> &&message)
+void HashCrackerThread::_msg_handler_set_task(const MsgBase &message)
 {
     std::cout << m_thread.get_thread_name() << " Received SET_TASK message\n";
     if (!m_finished_current_task) {
@@ -186,30 +343,22 @@ void HashCrackerThread::_msg_handler_set_task(std::unique_ptr<MsgBase> &&message
         return;
     }
 
-    auto msg = static_cast<sMSG_SET_TASK *>(message.get());
+    auto msg = static_cast<const sMSG_SET_TASK *>(&message);
 
-    m_hash_generator.set_initial_permutation(msg->initial_permutation);
-    m_max_permutations      = msg->max_permutations;
+    // The permutations after the end of the keyspace have no index, leave them out.
+    const auto end_index = std::min(msg->end_index, m_hash_generator.get_end_index());
+    if (msg->begin_index > end_index || !m_hash_generator.set_next_index(msg->begin_index)) {
+        std::cerr << m_thread.get_thread_name() << " Invalid task [" << msg->begin_index << ", "
+                  << msg->end_index << ")\n";
+        return;
+    }
+    m_next_index            = m_hash_generator.get_next_index();
+    m_end_index             = end_index;
     m_finished_current_task = false;
-    std::cout << m_thread.get_thread_name()
-              << " initial_permutation: " << std::quoted(msg->initial_permutation)
-              << " max_permutations: " << msg->max_permutations << "\n";
-}
-
-void HashCrackerThread::_msg_handler_remove_hash_from_list(std::unique_ptr<MsgBase> &&message)
-{
-    // std::cout << m_thread.get_thread_name() << " Received REMOVE_HASH_FROM_LIST message\n";
-
-    auto msg = static_cast<sMSG_REMOVE_HASH_FROM_LIST *>(message.get());
-
-    auto find_iter = std::find_if(m_hash_map.begin(), m_hash_map.end(),
-        [&](const sHashDict &hash_dict) { return hash_dict.encoded_hash == msg->hash; });
 
-    if (find_iter == m_hash_map.end()) {
-        std::cerr << "FATAL: Can't remove hash " << msg->hash
-                  << " since it does not exist in the list\n";
-    }
-    m_hash_map.erase(find_iter);
+    const auto first_permutation = m_hash_generator.get_candidate(m_next_index).value_or("");
+    std::cout << m_thread.get_thread_name() << " task: [" << m_next_index << ", " << m_end_index
+              << "), first permutation: " << std::quoted(first_permutation) << "\n";
 }
 
 /**************************************************************************************************/
@@ -218,14 +367,18 @@ void HashCrackerThread::_msg_handler_remove_hash_from_list(std::unique_ptr<MsgBa
 
 void HashCrackerThread::_send_finished_task()
 {
-    auto msg = std::make_unique<sMSG_FINISHED_TASK>(m_id);
-    _send_message(std::move(msg));
+    _send_message(sMSG_FINISHED_TASK(m_id));
 }
 
-void HashCrackerThread::_send_hash_discovery(std::string_view hash, std::string_view permutation)
+void HashCrackerThread::_send_hash_discovery(
+    const Sha256Engine::Digest &digest, std::string_view permutation)
 {
-    auto msg = std::make_unique<sMSG_HASH_DISCOVERY>(hash, permutation, m_id);
-    _send_message(std::move(msg));
+    size_t part_offset = 0;
+    do {
+        const sMSG_HASH_DISCOVERY msg(digest, permutation, part_offset, m_id);
+        _send_message(msg);
+        part_offset += msg.part_size;
+    } while (part_offset < permutation.size());
 }
 
 void HashCrackerThread::_send_hash_rate_update()
@@ -234,6 +387,8 @@ void HashCrackerThread::_send_hash_rate_update()
     if (rate == static_cast<uint64_t>(-1)) {
         return;
     }
-    auto msg = std::make_unique<sMSG_HASH_RATE_UPDATE>(m_id, rate);
-    _send_message(std::move(msg));
+    auto false_positive_rate = m_statistics.calculate_false_positive_rate(
+        m_prefilter_checks_counter, m_prefilter_false_positives_counter);
+
+    _send_message(sMSG_HASH_RATE_UPDATE(m_id, rate, false_positive_rate));
 }
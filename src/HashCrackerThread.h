@@ -1,11 +1,19 @@
 #pragma once
 
 #include "HashGenerator.h"
+#include "KeyspaceScheduler.h"
 #include "PollingScheduler.h"
 #include "Statistics.h"
+#include "TargetPrefilter.h"
+#include "TargetScanner.h"
+#include "TargetSet.h"
 #include "Thread.h"
 #include "ThreadMessageIO.h"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <memory>
 #include <optional>
 #include <string>
 #include <vector>
@@ -16,39 +24,46 @@
 enum eMessageType : uint16_t {
     SET_TASK,
     HASH_DISCOVERY,
-    REMOVE_HASH_FROM_LIST,
     FINISHED_TASK,
     HASH_RATE_UPDATE,
 };
 
 struct sMSG_SET_TASK : MsgBase {
-    sMSG_SET_TASK(std::string_view initial_permutation_, uint32_t max_permutations_) :
-        MsgBase(eMessageType::SET_TASK), initial_permutation(initial_permutation_),
-        max_permutations(max_permutations_)
+    sMSG_SET_TASK(uint64_t begin_index_, uint64_t end_index_) :
+        MsgBase(eMessageType::SET_TASK), begin_index(begin_index_), end_index(end_index_)
 
     {
     }
-    std::string initial_permutation;
-    uint32_t max_permutations;
+    // The task is the permutations in the keyspace indices range [begin_index, end_index).
+    uint64_t begin_index;
+    uint64_t end_index;
 };
 
+// The messages are plain data of a fixed size (see sMessageSlot), so a permutation longer than
+// @a max_permutation_part_size is sent in consecutive parts, all with the same digest.
 struct sMSG_HASH_DISCOVERY : MsgBase {
-    sMSG_HASH_DISCOVERY(std::string_view hash_, std::string_view permutation_, uint32_t id_) :
-        MsgBase(eMessageType::HASH_DISCOVERY), hash(hash_), permutation(permutation_), id(id_)
+    static constexpr size_t max_permutation_part_size = 64;
+
+    sMSG_HASH_DISCOVERY(const Sha256Engine::Digest &digest_, std::string_view permutation,
+        size_t part_offset_, uint32_t id_) :
+        MsgBase(eMessageType::HASH_DISCOVERY),
+        id(id_), digest(digest_), permutation_size(permutation.size()), part_offset(part_offset_),
+        part_size(std::min(permutation.size() - part_offset_, max_permutation_part_size))
     {
+        permutation.copy(permutation_part.data(), part_size, part_offset);
     }
-    std::string hash;
-    std::string permutation;
-    uint32_t id;
-};
 
-struct sMSG_REMOVE_HASH_FROM_LIST : MsgBase {
-    sMSG_REMOVE_HASH_FROM_LIST(std::string_view hash_) :
-        MsgBase(eMessageType::REMOVE_HASH_FROM_LIST), hash(hash_)
+    /**
+     * @brief Whether this part is the last one of the permutation.
+     */
+    bool is_last_part() const { return part_offset + part_size == permutation_size; }
 
-    {
-    }
-    std::string hash;
+    uint32_t id;
+    Sha256Engine::Digest digest;
+    uint32_t permutation_size;
+    uint32_t part_offset;
+    uint8_t part_size;
+    std::array<char, max_permutation_part_size> permutation_part;
 };
 
 struct sMSG_FINISHED_TASK : MsgBase {
@@ -61,13 +76,104 @@ struct sMSG_FINISHED_TASK : MsgBase {
 };
 
 struct sMSG_HASH_RATE_UPDATE : MsgBase {
-    sMSG_HASH_RATE_UPDATE(uint32_t worker_id_, uint64_t rate_) :
-        MsgBase(eMessageType::HASH_RATE_UPDATE), worker_id(worker_id_), rate(rate_)
+    sMSG_HASH_RATE_UPDATE(
+        uint32_t worker_id_, uint64_t rate_, double prefilter_false_positive_rate_) :
+        MsgBase(eMessageType::HASH_RATE_UPDATE),
+        worker_id(worker_id_), rate(rate_),
+        prefilter_false_positive_rate(prefilter_false_positive_rate_)
 
     {
     }
     uint32_t worker_id;
     uint64_t rate;
+    // Negative if the prefilter was not used since the previous update.
+    double prefilter_false_positive_rate;
+};
+
+/**************************************************************************************************/
+/* HashCrackerThread Configuration                                                                */
+/**************************************************************************************************/
+
+struct sHashCrackerConfig {
+    /**
+     * @brief Reject most candidates after the first rounds of SHA-256, by comparing their early
+     * reject word (see Sha256Engine) with the words reversed from the hash list. Applies only if
+     * the remaining hash list is small enough for the reversed words to fit in the cache, see
+     * @a early_reject_max_hashes.
+     */
+    bool early_reject = true;
+
+    static constexpr size_t early_reject_max_hashes = 16384;
+
+    /**
+     * @brief Log2 of the size in bits of the prefilter which rejects most hashes before the hash
+     * list lookup (see TargetPrefilter), or 0 to disable it. Applies only to hashes which are not
+     * rejected early.
+     */
+    uint8_t prefilter_bits_log2 = TargetPrefilter::default_bits_log2;
+
+    /**
+     * @brief Lengths bounds of the permutations, which define the keyspace of the tasks indices
+     * (see Keyspace).
+     */
+    size_t min_permutation_size = 1;
+    size_t max_permutation_size = CandidateOdometer::max_size;
+
+    /**
+     * @brief Charset of each position for a mask attack (see Mask), empty for a brute force attack
+     * with the valid characters at every position.
+     */
+    std::optional<Mask> mask;
+
+    /**
+     * @brief Words of a wordlist attack (see Wordlist), null to generate the permutations. The
+     * keyspace indices are then the offsets in the wordlist, and the lengths bounds don't apply.
+     * With a mask, it is a hybrid attack: each word is combined with each candidate of the mask,
+     * within the lengths bounds, at @a mask_position (see HashGenerator).
+     */
+    std::shared_ptr<const Wordlist> wordlist;
+    HashGenerator::eMaskPosition mask_position = HashGenerator::eMaskPosition::APPEND;
+
+    /**
+     * @brief Right words of a combinator attack, each appended to each word of @a wordlist, null
+     * otherwise. The keyspace indices are then the offsets in @a wordlist times the size of the
+     * right wordlist, plus the offsets in it (see HashGenerator).
+     */
+    std::shared_ptr<const Wordlist> right_wordlist;
+
+    /**
+     * @brief Rules which mangle each word of a wordlist attack (see RuleSet), null to hash the
+     * words as is.
+     */
+    std::shared_ptr<const RuleSet> rules;
+
+    /**
+     * @brief How the messages move between the HashCrackerThread and the main thread (see
+     * ThreadMessageIO). Each direction has a single sender and a single handler thread, which
+     * suits the ring buffers.
+     */
+    eMessageTransport message_transport = eMessageTransport::SPSC_RING_BUFFERS;
+
+    /**
+     * @brief Cracked hashes stay in the prefilter until it is rebuilt. It is rebuilt once more than
+     * 1/prefilter_rebuild_ratio of the remaining hashes are cracked.
+     */
+    static constexpr size_t prefilter_rebuild_ratio = 16;
+
+    /**
+     * @brief Target duration of a chunk taken from the KeyspaceScheduler. The chunk size adapts to
+     * the hash rate of each thread, so the threads finish the keyspace within about one chunk of
+     * each other, while the scheduling cost stays negligible.
+     */
+    static constexpr auto chunk_duration         = std::chrono::milliseconds(100);
+    static constexpr uint64_t initial_chunk_size = 1 << 16;
+    static constexpr uint64_t min_chunk_size     = sHashBatch::capacity;
+
+    /**
+     * @brief Maximal duration an idle thread blocks waiting for a message, so that its scheduled
+     * tasks still run.
+     */
+    static constexpr auto idle_timeout = std::chrono::seconds(1);
 };
 
 /**************************************************************************************************/
@@ -81,8 +187,10 @@ class HashCrackerThread {
      *
      * @param id Thread ID.
      * @param hash_generator HashGenerator object.
+     * @param config Configuration.
      */
-    HashCrackerThread(uint32_t id, HashGenerator &&hash_generator);
+    HashCrackerThread(
+        uint32_t id, HashGenerator &&hash_generator, const sHashCrackerConfig &config = {});
 
     /**
      * @brief Initialize the HashCrackerThread instance. Should be called only if the instance is
@@ -116,9 +224,18 @@ class HashCrackerThread {
     /**
      * @brief Set the hash list.
      *
-     * @param encrypted_password_list List of encrypted passwords.
+     * @param target_set List of encrypted passwords, shared with the other HashCrackerThreads.
+     */
+    void set_target_set(std::shared_ptr<TargetSet> target_set);
+
+    /**
+     * @brief Set the keyspace scheduler. Once the current task is done, the thread takes chunks of
+     * the keyspace from it, and sends FINISHED_TASK when no chunk is left.
+     *
+     * @param keyspace_scheduler Scheduler shared with the other HashCrackerThreads, the thread ID
+     * is its worker index.
      */
-    void set_hash_list(const std::vector<std::string_view> &encrypted_password_list);
+    void set_keyspace_scheduler(std::shared_ptr<KeyspaceScheduler> keyspace_scheduler);
 
   private:
     /**
@@ -130,45 +247,90 @@ class HashCrackerThread {
     bool _thread_init();
 
     /**
-     * @brief Performs the thread work, which includes a new permutation hash calculation and
-     * comparison to the list of known hashes.
+     * @brief Performs the thread work, which includes a batch of new permutation hashes
+     * calculation and comparison to the list of known hashes.
      */
     void _work();
 
+    /**
+     * @brief Take the next chunk from @a m_keyspace_scheduler and set it as the current task.
+     *
+     * @return true if a chunk was taken, otherwise false.
+     */
+    bool _start_next_chunk();
+
+    /**
+     * @brief Report the current chunk as completed, and adapt the size of the next chunk to the
+     * measured hash rate.
+     */
+    void _complete_chunk();
+
     /* Message Handlers */
-    void _msg_handler_set_task(std::unique_ptr<MsgBase> &&message);
-    void _msg_handler_remove_hash_from_list(std::unique_ptr<MsgBase> &&message);
+    void _msg_handler_set_task(const MsgBase &message);
 
     /* Messeger Senders */
     void _send_finished_task();
-    void _send_hash_discovery(std::string_view hash, std::string_view permutation);
+    void _send_hash_discovery(const Sha256Engine::Digest &digest, std::string_view permutation);
     void _send_hash_rate_update();
 
+    /**
+     * @brief A general handle messages function, initialized like @a _send_message.
+     */
+    std::function<void()> _handle_messages;
+
     /**
      * @brief A general send message function. This function pointer is initialized to the
      * appropriate send function of the internal message endpoint to send the message with, a thread
      * safe or not.
      */
-    std::function<void(std::unique_ptr<MsgBase> &&msg)> _send_message;
+    std::function<void(const sMessageSlot &msg)> _send_message;
 
-    struct sHashDict {
-        std::string encoded_hash;
-        std::string decoded_hash;
-    };
+    /**
+     * @brief Check if @a digest is in the list of known hashes, and if so mark it as cracked and
+     * notify about the discovery.
+     *
+     * @param digest The hash of @a permutation.
+     * @param permutation The permutation.
+     * @return true if @a digest is in the list of known hashes, otherwise false.
+     */
+    bool _check_hash(const Sha256Engine::Digest &digest, std::string_view permutation);
 
     /**
-     * @brief Find given base64 decoded hash in the list of known hashes.
+     * @brief Mark the hash at @a target_index of the list as cracked and notify about the
+     * discovery, unless another thread already cracked it.
      *
-     * @return std::optional, containing an iterator to the found element if found, otherwise
-     * std::nullopt.
+     * @param target_index Index of the hash in the list.
+     * @param permutation The permutation which hashes to it.
+     */
+    void _report_match(size_t target_index, std::string_view permutation);
+
+    /**
+     * @brief Update the data derived from the hashes which are not cracked yet. Should be called
+     * after each change of the list, see @a m_target_set_cracked_count.
+     */
+    void _update_target_filters();
+
+    /**
+     * @brief Rebuild the early reject words from the hashes which are not cracked yet.
+     */
+    void _update_early_reject_words();
+
+    /**
+     * @brief Rebuild the prefilter if too many of its hashes are cracked.
+     */
+    void _update_prefilter();
+
+    /**
+     * @brief Rebuild the scanner keys from the hashes which are not cracked yet, if there are
+     * few enough of them.
      */
-    using VectorOfHashDictIterator = std::vector<sHashDict>::const_iterator;
-    const std::optional<VectorOfHashDictIterator> _find_hash_encrypted_password_list(
-        std::string_view b64_decoded_hash) const;
+    void _update_scanner();
 
     // Object ID
     const uint32_t m_id;
 
+    const sHashCrackerConfig m_config;
+
     Thread m_thread;
     PollingScheduler m_scheduler;
     HashGenerator m_hash_generator;
@@ -181,14 +343,70 @@ class HashCrackerThread {
     MsgInternalEndPoint &m_message_endpoint;
 
     /**
-     * @brief Vector that maps base64 decode hash to the encoded.
+     * @brief The list of known hashes, shared with the other HashCrackerThreads.
+     */
+    std::shared_ptr<TargetSet> m_target_set;
+
+    /**
+     * @brief The cracked hashes count of @a m_target_set when the data derived from the remaining
+     * hashes was last built. Hashes cracked by other threads are detected by comparing it with
+     * the current count between batches.
+     */
+    size_t m_target_set_cracked_count = 0;
+
+    /**
+     * @brief Sorted early reject words of the remaining hashes in @a m_target_set, used only if
+     * @a m_early_reject_enabled is set.
+     */
+    std::vector<uint32_t> m_early_reject_words;
+    bool m_early_reject_enabled = false;
+
+    /**
+     * @brief Prefilter of the hashes in @a m_target_set, empty if disabled. Built when the cracked
+     * hashes count of @a m_target_set was @a m_prefilter_cracked_count.
+     */
+    std::optional<TargetPrefilter> m_prefilter;
+    size_t m_prefilter_cracked_count = 0;
+
+    /**
+     * @brief Scanner of the hashes in @a m_target_set, used instead of the early reject words
+     * binary search or the prefilter if @a m_scanner_enabled is set. Its keys are the early reject
+     * words if @a m_early_reject_enabled is set, otherwise the digests keys.
+     */
+    TargetScanner m_scanner;
+    bool m_scanner_enabled = false;
+
+    /**
+     * @brief Prefilter statistics counters.
+     */
+    uint64_t m_prefilter_checks_counter          = 0;
+    uint64_t m_prefilter_false_positives_counter = 0;
+
+    /**
+     * @brief The latest batch of permutations and hashes produced by @a m_hash_generator.
+     */
+    sHashBatch m_hash_batch;
+
+    /**
+     * @brief Current task variables, the keyspace index of the next permutation and the end of
+     * the task range. In a wordlist attack, the indices are the offsets in the wordlist.
+     */
+    uint64_t m_next_index        = 0;
+    uint64_t m_end_index         = 0;
+    bool m_finished_current_task = true;
+
+    /**
+     * @brief The keyspace scheduler shared by all the HashCrackerThreads, if any, and its chunk
+     * which is the current task.
      */
-    std::vector<sHashDict> m_hash_map;
+    std::shared_ptr<KeyspaceScheduler> m_keyspace_scheduler;
+    std::optional<KeyspaceScheduler::sChunk> m_current_chunk;
+    std::chrono::steady_clock::time_point m_chunk_start_time;
+    uint64_t m_chunk_size     = sHashCrackerConfig::initial_chunk_size;
+    bool m_keyspace_exhausted = false;
 
     /**
-     * @brief Current task variables
+     * @brief Number of permutations hashed in all the tasks.
      */
-    uint64_t m_max_permutations    = 0;
     uint64_t m_permutation_counter = 0;
-    bool m_finished_current_task   = true;
 };
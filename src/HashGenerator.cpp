@@ -1,33 +1,334 @@
 #include "HashGenerator.h"
 
-#include "BaseOperationsUtils.h"
-
+#include <algorithm>
 #include <base64.h>
+#include <cstring>
+#include <iostream>
 #include <sha256.h>
 
 HashGenerator::HashGenerator(
     std::string_view salt, std::string_view pepper, std::string_view valid_characters) :
+    HashGenerator(salt, pepper, valid_characters, 1, CandidateOdometer::max_size)
+{
+}
+
+HashGenerator::HashGenerator(std::string_view salt, std::string_view pepper,
+    std::string_view valid_characters, size_t min_permutation_size, size_t max_permutation_size) :
+    HashGenerator(salt, pepper, Mask::from_charset(valid_characters), min_permutation_size,
+        max_permutation_size)
+{
+}
+
+HashGenerator::HashGenerator(std::string_view salt, std::string_view pepper, const Mask &mask,
+    size_t min_permutation_size, size_t max_permutation_size) :
+    m_salt(salt),
+    m_pepper(pepper), m_odometer(std::in_place, mask),
+    m_keyspace(std::in_place, mask, min_permutation_size, max_permutation_size)
+{
+    _build_message_templates();
+}
+
+HashGenerator::HashGenerator(
+    std::string_view salt, std::string_view pepper, std::shared_ptr<const Wordlist> wordlist) :
+    HashGenerator(salt, pepper, std::move(wordlist), std::shared_ptr<const RuleSet>())
+{
+}
+
+HashGenerator::HashGenerator(std::string_view salt, std::string_view pepper,
+    std::shared_ptr<const Wordlist> wordlist, std::shared_ptr<const RuleSet> rules) :
+    m_salt(salt),
+    m_pepper(pepper), m_wordlist(std::move(wordlist)), m_rules(std::move(rules))
+{
+    const auto data = m_wordlist->get_data();
+    m_wordlist_end  = data.data() + data.size();
+
+    if (m_rules) {
+        m_rule_words      = std::make_unique<RuleSet::sWordBatch>();
+        m_rule_candidates = std::make_unique<RuleSet::sWordBatch>();
+        m_rule_index      = m_rules->size();
+    }
+
+    _build_message_templates();
+}
+
+HashGenerator::HashGenerator(std::string_view salt, std::string_view pepper,
+    std::shared_ptr<const Wordlist> wordlist, const Mask &mask, size_t min_mask_size,
+    size_t max_mask_size, eMaskPosition mask_position) :
+    m_salt(salt),
+    m_pepper(pepper), m_odometer(std::in_place, mask),
+    m_keyspace(std::in_place, mask, min_mask_size, max_mask_size), m_wordlist(std::move(wordlist)),
+    m_mask_position(mask_position), m_mask_begin(*m_keyspace->get_previous_candidate(0))
+{
+    const auto data = m_wordlist->get_data();
+    m_wordlist_end  = data.data() + data.size();
+
+    // The first word is read on the first permutation.
+    m_mask_index = m_keyspace->size();
+
+    _build_message_templates();
+}
+
+HashGenerator::HashGenerator(std::string_view salt, std::string_view pepper,
+    std::shared_ptr<const Wordlist> left_wordlist, std::shared_ptr<const Wordlist> right_wordlist) :
     m_salt(salt),
-    m_pepper(pepper), m_valid_characters(valid_characters)
+    m_pepper(pepper), m_wordlist(std::move(left_wordlist)),
+    m_right_wordlist(std::move(right_wordlist))
 {
+    const auto data       = m_wordlist->get_data();
+    m_wordlist_end        = data.data() + data.size();
+    const auto right_data = m_right_wordlist->get_data();
+    m_right_wordlist_end  = right_data.data() + right_data.size();
+
+    // The right words are read again for each left word, keep them all in memory.
+    m_right_wordlist->will_need(0, m_right_wordlist->size());
+
+    // The first left word is read on the first permutation.
+    m_right_cursor = m_right_wordlist->get_cursor(m_right_wordlist->size());
+
+    _build_message_templates();
+    m_left_word_blocks.resize(m_message_templates.size());
 }
 
 HashGenerator::HashGenerator(HashGenerator &&hash_generator) :
-    m_current_permutation(std::move(hash_generator.m_current_permutation)),
     m_salt(std::move(hash_generator.m_salt)), m_pepper(std::move(hash_generator.m_pepper)),
-    m_valid_characters(std::move(hash_generator.m_valid_characters))
+    m_sha256_engine(hash_generator.m_sha256_engine),
+    m_odometer(std::move(hash_generator.m_odometer)),
+    m_keyspace(std::move(hash_generator.m_keyspace)),
+    m_wordlist(std::move(hash_generator.m_wordlist)),
+    m_wordlist_end(hash_generator.m_wordlist_end), m_word_cursor(hash_generator.m_word_cursor),
+    m_current_word(hash_generator.m_current_word),
+    m_readahead_index(hash_generator.m_readahead_index),
+    m_rules(std::move(hash_generator.m_rules)),
+    m_rule_words(std::move(hash_generator.m_rule_words)),
+    m_rule_candidates(std::move(hash_generator.m_rule_candidates)),
+    m_rule_index(hash_generator.m_rule_index),
+    m_rule_candidate_index(hash_generator.m_rule_candidate_index),
+    m_mask_position(hash_generator.m_mask_position), m_word_offset(hash_generator.m_word_offset),
+    m_mask_index(hash_generator.m_mask_index),
+    m_mask_begin(std::move(hash_generator.m_mask_begin)),
+    m_word_block(hash_generator.m_word_block),
+    m_word_block_mask_size(hash_generator.m_word_block_mask_size),
+    m_current_permutation(std::move(hash_generator.m_current_permutation)),
+    m_right_wordlist(std::move(hash_generator.m_right_wordlist)),
+    m_right_wordlist_end(hash_generator.m_right_wordlist_end),
+    m_right_cursor(hash_generator.m_right_cursor),
+    m_left_word_blocks(std::move(hash_generator.m_left_word_blocks)),
+    m_left_word_block_sizes(hash_generator.m_left_word_block_sizes),
+    m_next_index(hash_generator.m_next_index),
+    m_message_templates(std::move(hash_generator.m_message_templates))
+{
+}
+
+bool HashGenerator::set_initial_permutation(std::string_view initial_permutation)
+{
+    if (m_wordlist) {
+        std::cerr << "No initial permutation in a wordlist attack\n";
+        return false;
+    }
+
+    // The batches blocks hold permutations far from the new one.
+    m_last_batch = nullptr;
+
+    if (!m_odometer->set(initial_permutation)) {
+        return false;
+    }
+
+    // The permutations out of the keyspace have no index.
+    const auto index = m_keyspace->get_index(initial_permutation);
+    m_next_index     = index ? *index + 1 : 0;
+    return true;
+}
+
+bool HashGenerator::set_next_index(uint64_t index)
+{
+    if (_is_combinator()) {
+        if (index > get_end_index()) {
+            std::cerr << "Index " << index << " is out of the combinator keyspace of size "
+                      << get_end_index() << "\n";
+            return false;
+        }
+
+        // The index is in the right words of the left word at its offset, if there is one there,
+        // otherwise it is before the first right word of the next left word.
+        const auto right_size  = m_right_wordlist->size();
+        const auto left_offset = right_size ? index / right_size : m_wordlist->size();
+        m_word_cursor          = m_wordlist->get_cursor(left_offset);
+        m_readahead_index      = m_word_cursor.offset;
+        if (_next_left_word() && m_word_offset == left_offset) {
+            m_right_cursor = m_right_wordlist->get_cursor(index % right_size);
+            m_next_index   = m_word_offset * right_size + m_right_cursor.offset;
+        }
+        return true;
+    }
+
+    if (_is_hybrid()) {
+        if (index > get_end_index()) {
+            std::cerr << "Index " << index << " is out of the hybrid keyspace of size "
+                      << get_end_index() << "\n";
+            return false;
+        }
+
+        // The index is in the mask candidates of the word at its offset, if there is one there,
+        // otherwise it is before the first candidate of the next word.
+        const auto mask_count = m_keyspace->size();
+        const auto offset     = index / mask_count;
+        m_word_cursor         = m_wordlist->get_cursor(offset);
+        m_readahead_index     = m_word_cursor.offset;
+        if (_next_hybrid_word() && m_word_offset == offset && index % mask_count != 0) {
+            m_mask_index = index % mask_count;
+            m_next_index = index;
+            m_odometer->set(*m_keyspace->get_previous_candidate(m_mask_index));
+        }
+        return true;
+    }
+
+    if (m_wordlist) {
+        if (index > m_wordlist->size()) {
+            std::cerr << "Offset " << index << " is out of the wordlist of size "
+                      << m_wordlist->size() << "\n";
+            return false;
+        }
+
+        m_word_cursor     = m_wordlist->get_cursor(index);
+        m_next_index      = m_word_cursor.offset;
+        m_readahead_index = m_next_index;
+
+        // The next window of words is loaded on the next permutation.
+        if (m_rules) {
+            m_rule_index            = m_rules->size();
+            m_rule_candidates->size = 0;
+            m_rule_candidate_index  = 0;
+        }
+        return true;
+    }
+
+    auto previous_permutation = m_keyspace->get_previous_candidate(index);
+    if (!previous_permutation) {
+        std::cerr << "Index " << index << " is out of the keyspace of size " << m_keyspace->size()
+                  << "\n";
+        return false;
+    }
+
+    if (!set_initial_permutation(*previous_permutation)) {
+        return false;
+    }
+    m_next_index = index;
+    return true;
+}
+
+uint64_t HashGenerator::get_end_index() const
 {
+    if (_is_combinator()) {
+        return m_wordlist->size() * m_right_wordlist->size();
+    }
+    if (_is_hybrid()) {
+        return m_wordlist->size() * m_keyspace->size();
+    }
+    return m_wordlist ? m_wordlist->size() : m_keyspace->size();
 }
 
-void HashGenerator::set_initial_permutation(std::string_view initial_permutation)
+std::optional<std::string> HashGenerator::get_candidate(uint64_t index) const
 {
-    m_current_permutation.assign(initial_permutation);
+    if (!m_wordlist) {
+        return m_keyspace->get_candidate(index);
+    }
+
+    if (_is_combinator()) {
+        const auto right_size  = m_right_wordlist->size();
+        const auto left_offset = right_size ? index / right_size : m_wordlist->size();
+        auto cursor = m_wordlist->get_cursor(left_offset);
+        while (cursor.offset < m_wordlist->size()) {
+            const auto word_offset = cursor.offset;
+            const auto left_word   = m_wordlist->next_word(cursor);
+            if (left_word.empty()) {
+                continue;
+            }
+
+            // The first right word of a left word after the offset.
+            auto right_cursor = m_right_wordlist->get_cursor(
+                word_offset == left_offset ? index % right_size : 0);
+            while (right_cursor.offset < right_size) {
+                const auto right_word = m_right_wordlist->next_word(right_cursor);
+                if (!right_word.empty()) {
+                    return std::string(left_word).append(right_word);
+                }
+            }
+        }
+        return std::nullopt;
+    }
+
+    if (_is_hybrid()) {
+        const auto mask_count = m_keyspace->size();
+        const auto offset     = index / mask_count;
+        for (auto cursor = m_wordlist->get_cursor(offset); cursor.offset < m_wordlist->size();) {
+            const auto word_offset = cursor.offset;
+            const auto word        = m_wordlist->next_word(cursor);
+            if (word.empty()) {
+                continue;
+            }
+
+            // The first mask candidate of a word after the offset.
+            std::string permutation;
+            _assign_hybrid_permutation(permutation, word,
+                *m_keyspace->get_candidate(word_offset == offset ? index % mask_count : 0));
+            return permutation;
+        }
+        return std::nullopt;
+    }
+
+    for (auto cursor = m_wordlist->get_cursor(index); cursor.offset < m_wordlist->size();) {
+        const auto word = m_wordlist->next_word(cursor);
+        if (word.empty()) {
+            continue;
+        }
+        if (!m_rules) {
+            return std::string(word);
+        }
+
+        // The first rule on the word, unless it is too long for the rules or rejected.
+        RuleSet::sWordBatch words;
+        RuleSet::sWordBatch candidates;
+        if (words.add(word)) {
+            m_rules->apply(0, words, candidates);
+            return std::string(candidates.get(0));
+        }
+    }
+    return std::nullopt;
 }
 
-std::string HashGenerator::get_next_permutation_hash()
+Sha256Engine::Digest HashGenerator::get_next_permutation_hash()
 {
-    // Fill m_current_permutation with next password permutation
-    BaseOperationsUtils::increment_base_x_integer(m_current_permutation, m_valid_characters);
+    if (_is_combinator()) {
+        const auto right_word = _next_right_word(get_end_index());
+        if (right_word.empty()) {
+            m_current_permutation.clear();
+        } else {
+            m_current_permutation.assign(m_current_word).append(right_word);
+        }
+        return _encrypt_password(_get_spiced_permutation());
+    }
+
+    if (_is_hybrid()) {
+        if (m_mask_index == m_keyspace->size() && !_next_hybrid_word()) {
+            m_current_permutation.clear();
+        } else {
+            m_odometer->increment();
+            ++m_mask_index;
+            ++m_next_index;
+            _assign_hybrid_permutation(m_current_permutation, m_current_word, m_odometer->get());
+        }
+        return _encrypt_password(_get_spiced_permutation());
+    }
+
+    if (m_wordlist) {
+        m_current_word =
+            m_rules ? _next_rule_word(m_wordlist->size()) : _next_word(m_wordlist->size());
+        return _encrypt_password(_get_spiced_permutation());
+    }
+
+    // Fill m_odometer with next password permutation
+    m_odometer->increment();
+    ++m_next_index;
 
     // Adds "salt" and "pepper" to the the password
     auto decrypted_password = _get_spiced_permutation();
@@ -39,13 +340,556 @@ std::string HashGenerator::get_next_permutation_hash()
 std::string HashGenerator::_get_spiced_permutation()
 {
     std::string decrypted_pass;
-    decrypted_pass.reserve(m_salt.size() + m_current_permutation.size() + m_pepper.size());
-    decrypted_pass.append(m_salt).append(m_current_permutation).append(m_pepper);
+    const auto permutation = get_current_permutation();
+    decrypted_pass.reserve(m_salt.size() + permutation.size() + m_pepper.size());
+    decrypted_pass.append(m_salt).append(permutation).append(m_pepper);
     return decrypted_pass;
 }
 
-std::string HashGenerator::_encrypt_password(std::string_view decrypted_password)
+Sha256Engine::Digest HashGenerator::_encrypt_password(std::string_view decrypted_password)
 {
+    Sha256Engine::Digest digest;
     SHA256 sha256;
-    return sha256(decrypted_password.data(), decrypted_password.size());
+    sha256.add(decrypted_password.data(), decrypted_password.size());
+    sha256.getHash(digest.data());
+    return digest;
+}
+
+size_t HashGenerator::next_hashes(sHashBatch &batch, size_t max_count)
+{
+    next_permutations(batch, max_count);
+
+    m_sha256_engine.hash_blocks(batch.blocks.data(), batch.hashes.data(), batch.size);
+    _hash_long_permutations(batch);
+
+    return batch.size;
+}
+
+size_t HashGenerator::next_early_reject_words(sHashBatch &batch, size_t max_count)
+{
+    next_permutations(batch, max_count);
+
+    m_sha256_engine.hash_blocks_early_reject(
+        batch.blocks.data(), batch.early_reject_words.data(), batch.size);
+
+    // The long permutations are fully hashed anyway, derive their word from the digest.
+    _hash_long_permutations(batch);
+    for (size_t i = 0; i < batch.long_permutations_count; ++i) {
+        auto index                       = batch.long_permutation_indices[i];
+        batch.early_reject_words[index] = Sha256Engine::get_early_reject_word(batch.hashes[index]);
+    }
+
+    return batch.size;
+}
+
+const Sha256Engine::Digest &HashGenerator::complete_hash(sHashBatch &batch, size_t index) const
+{
+    // Long permutations are already fully hashed.
+    if (batch.permutations[index].size() < m_message_templates.size()) {
+        m_sha256_engine.hash_blocks(&batch.blocks[index], &batch.hashes[index], 1);
+    }
+    return batch.hashes[index];
+}
+
+size_t HashGenerator::next_permutations(sHashBatch &batch, size_t max_count)
+{
+    if (_is_combinator()) {
+        const auto end_index =
+            m_next_index + std::min<uint64_t>(max_count, get_end_index() - m_next_index);
+        return _next_combined_words(batch, end_index);
+    }
+
+    if (_is_hybrid()) {
+        const auto end_index =
+            m_next_index + std::min<uint64_t>(max_count, get_end_index() - m_next_index);
+        return _next_hybrid_permutations(batch, end_index);
+    }
+
+    if (m_wordlist) {
+        const auto end_offset =
+            m_next_index + std::min<uint64_t>(max_count, m_wordlist->size() - m_next_index);
+        return _next_words(batch, end_offset);
+    }
+
+    batch.size                    = std::min(max_count, sHashBatch::capacity);
+    batch.long_permutations_count = 0;
+
+    // Unless the batch was filled to capacity by the previous call, its blocks content is unknown.
+    if (m_last_batch != &batch || batch.blocks_owner != this) {
+        batch.block_permutation_sizes.fill(sHashBatch::invalid_block_permutation_size);
+    }
+
+    /**
+     * @details A block holds the permutation of the previous call, a full batch earlier. The
+     * characters which differ between them are to the right of the leftmost position changed by
+     * the increments between them, which are all in the previous call or in this one.
+     */
+    size_t changed_position = CandidateOdometer::max_size;
+
+    for (size_t i = 0; i < batch.size;) {
+        changed_position = std::min(changed_position, m_odometer->increment());
+        auto block_changed_position = std::min(changed_position, m_last_batch_changed_position);
+        _write_permutation(batch, i++, block_changed_position);
+
+        // Most of the next permutations differ only by the last character, write them as a run.
+        const auto permutation = m_odometer->get();
+        if (permutation.empty() || permutation.size() >= m_message_templates.size()) {
+            continue;
+        }
+        const auto run_size     = std::min(m_odometer->get_last_character_run(), batch.size - i);
+        const auto digit        = m_odometer->get_last_digit();
+        const auto last_charset = m_odometer->get_last_position_charset();
+
+        // A block of the same size needs at most its last character and one before it, unless a
+        // carry went further since it was filled.
+        const auto last_position = permutation.size() - 1;
+        block_changed_position   = std::min(block_changed_position, last_position);
+        for (size_t j = 1; j <= run_size; ++j, ++i) {
+            auto permutation_bytes =
+                reinterpret_cast<char *>(batch.blocks[i].bytes + m_salt.size());
+            if (batch.block_permutation_sizes[i] != permutation.size() ||
+                block_changed_position + 1 < last_position) {
+                _update_block(batch, i, permutation, block_changed_position);
+            } else if (block_changed_position < last_position) {
+                permutation_bytes[block_changed_position] = permutation[block_changed_position];
+            }
+            permutation_bytes[last_position] = last_charset[digit + j];
+        }
+        m_odometer->increment_last_character(run_size);
+    }
+
+    batch.blocks_owner            = this;
+    m_last_batch                  = batch.size == sHashBatch::capacity ? &batch : nullptr;
+    m_last_batch_changed_position = changed_position;
+    m_next_index += batch.size;
+
+    return batch.size;
+}
+
+size_t HashGenerator::_next_words(sHashBatch &batch, uint64_t end_offset)
+{
+    batch.size                    = 0;
+    batch.long_permutations_count = 0;
+
+    if (m_rules) {
+        while (batch.size < sHashBatch::capacity) {
+            const auto word = _next_rule_word(end_offset);
+            if (word.empty()) {
+                break;
+            }
+            _write_word(batch, batch.size++, word, word.data() + RuleSet::max_word_size);
+            m_current_word = word;
+        }
+    } else {
+        while (batch.size < sHashBatch::capacity) {
+            const auto word = _next_word(end_offset);
+            if (word.empty()) {
+                break;
+            }
+            _write_word(batch, batch.size++, word, m_wordlist_end);
+            m_current_word = word;
+        }
+    }
+
+    batch.blocks_owner = this;
+    return batch.size;
+}
+
+std::string_view HashGenerator::_next_word(uint64_t end_offset)
+{
+    while (m_word_cursor.offset < end_offset) {
+        // Keep the kernel reading between half and a whole readahead size ahead.
+        if (m_word_cursor.offset >= m_readahead_index) {
+            m_wordlist->will_need(m_word_cursor.offset, Wordlist::readahead_size);
+            m_readahead_index = m_word_cursor.offset + Wordlist::readahead_size / 2;
+        }
+
+        const auto word = m_wordlist->next_word(m_word_cursor);
+        if (!word.empty()) {
+            m_next_index = m_word_cursor.offset;
+            return word;
+        }
+    }
+    m_next_index = m_word_cursor.offset;
+    return {};
+}
+
+std::string_view HashGenerator::_next_rule_word(uint64_t end_offset)
+{
+    while (true) {
+        // The words of the window mangled by the latest rule, the rejected ones are empty.
+        while (m_rule_candidate_index < m_rule_candidates->size) {
+            const auto word = m_rule_candidates->get(m_rule_candidate_index++);
+            if (word.empty()) {
+                continue;
+            }
+
+            // The window is done with its last word mangled by the last rule.
+            if (m_rule_candidate_index == m_rule_candidates->size &&
+                m_rule_index == m_rules->size()) {
+                m_next_index = m_word_cursor.offset;
+            }
+            return word;
+        }
+
+        // All the rules are applied to the window, load the next one.
+        if (m_rule_index == m_rules->size()) {
+            const auto window_begin = m_word_cursor.offset;
+            m_rule_words->size      = 0;
+            while (m_rule_words->size < RuleSet::sWordBatch::capacity) {
+                const auto word = _next_word(end_offset);
+                if (word.empty()) {
+                    break;
+                }
+                m_rule_words->add(word);
+            }
+            if (m_rule_words->size == 0) {
+                return {};
+            }
+
+            // The window is done only once all the rules are applied to all its words.
+            m_next_index = window_begin;
+            m_rule_index = 0;
+        }
+
+        m_rules->apply(m_rule_index++, *m_rule_words, *m_rule_candidates);
+        m_rule_candidate_index = 0;
+    }
+}
+
+size_t HashGenerator::_next_combined_words(sHashBatch &batch, uint64_t end_index)
+{
+    batch.size                    = 0;
+    batch.long_permutations_count = 0;
+
+    while (batch.size < sHashBatch::capacity) {
+        const auto right_word = _next_right_word(end_index);
+        if (right_word.empty()) {
+            break;
+        }
+        _write_combined_word(batch, batch.size++, right_word);
+    }
+
+    batch.blocks_owner = this;
+    return batch.size;
+}
+
+std::string_view HashGenerator::_next_right_word(uint64_t end_index)
+{
+    const auto right_size = m_right_wordlist->size();
+    while (true) {
+        if (m_right_cursor.offset == right_size && !_next_left_word()) {
+            return {};
+        }
+        if (m_next_index >= end_index) {
+            return {};
+        }
+
+        // The right words of the current left word, up to the end of the indices.
+        const auto index_base = m_word_offset * right_size;
+        const auto right_end  = std::min(right_size, end_index - index_base);
+        while (m_right_cursor.offset < right_end) {
+            const auto right_word = m_right_wordlist->next_word(m_right_cursor);
+            m_next_index          = index_base + m_right_cursor.offset;
+            if (!right_word.empty()) {
+                return right_word;
+            }
+        }
+    }
+}
+
+bool HashGenerator::_next_left_word()
+{
+    m_current_word          = _next_word(m_wordlist->size());
+    m_left_word_block_sizes = 0;
+    if (m_current_word.empty()) {
+        m_next_index = get_end_index();
+        return false;
+    }
+
+    m_word_offset  = m_current_word.data() - m_wordlist->get_data().data();
+    m_right_cursor = m_right_wordlist->get_cursor(0);
+    m_next_index   = m_word_offset * m_right_wordlist->size();
+    return true;
+}
+
+void HashGenerator::_write_combined_word(
+    sHashBatch &batch, size_t index, std::string_view right_word)
+{
+    const auto permutation_size = m_current_word.size() + right_word.size();
+
+    // Rare case, the permutation doesn't fit in a single block.
+    if (permutation_size >= m_message_templates.size()) {
+        batch.long_permutations[index].assign(m_current_word).append(right_word);
+        _add_long_permutation(batch, index);
+        return;
+    }
+
+    // The left word is rendered once per length of the right words.
+    auto &left_word_block = m_left_word_blocks[right_word.size()];
+    if (!(m_left_word_block_sizes & (uint64_t(1) << right_word.size()))) {
+        left_word_block = m_message_templates[permutation_size];
+        std::memcpy(left_word_block.bytes + m_salt.size(), m_current_word.data(),
+            m_current_word.size());
+        m_left_word_block_sizes |= uint64_t(1) << right_word.size();
+    }
+
+    auto &block            = batch.blocks[index];
+    auto permutation_bytes = reinterpret_cast<char *>(block.bytes + m_salt.size());
+    _copy_word(block, left_word_block, m_salt.size() + m_current_word.size(), right_word,
+        m_right_wordlist_end);
+
+    batch.block_permutation_sizes[index] = static_cast<uint8_t>(permutation_size);
+    batch.permutations[index]            = {permutation_bytes, permutation_size};
+}
+
+size_t HashGenerator::_next_hybrid_permutations(sHashBatch &batch, uint64_t end_index)
+{
+    batch.size                    = 0;
+    batch.long_permutations_count = 0;
+
+    const auto mask_count = m_keyspace->size();
+    while (batch.size < sHashBatch::capacity) {
+        if (m_mask_index == mask_count && !_next_hybrid_word()) {
+            break;
+        }
+        if (m_next_index >= end_index) {
+            break;
+        }
+
+        // The mask candidates of the current word, only their characters change in the blocks.
+        const size_t count = std::min<uint64_t>({sHashBatch::capacity - batch.size,
+            mask_count - m_mask_index, end_index - m_next_index});
+        for (size_t i = 0; i < count;) {
+            m_odometer->increment();
+            _write_hybrid_permutation(batch, batch.size++);
+            ++i;
+
+            // Most of the next candidates differ only by the last character, write them as a run
+            // of copies of the block.
+            const auto permutation_size = batch.block_permutation_sizes[batch.size - 1];
+            if (permutation_size == sHashBatch::invalid_block_permutation_size) {
+                continue;
+            }
+            const auto &block       = batch.blocks[batch.size - 1];
+            const auto run_size     = std::min(m_odometer->get_last_character_run(), count - i);
+            const auto digit        = m_odometer->get_last_digit();
+            const auto last_charset = m_odometer->get_last_position_charset();
+            const auto mask_end =
+                m_mask_position == eMaskPosition::APPEND ? permutation_size : m_odometer->size();
+            const auto last_position = m_salt.size() + mask_end - 1;
+
+            for (size_t j = 1; j <= run_size; ++j, ++i) {
+                auto &run_block                = batch.blocks[batch.size];
+                run_block                      = block;
+                run_block.bytes[last_position] = last_charset[digit + j];
+
+                batch.block_permutation_sizes[batch.size] = permutation_size;
+                batch.permutations[batch.size++]          = {
+                    reinterpret_cast<char *>(run_block.bytes + m_salt.size()), permutation_size};
+            }
+            m_odometer->increment_last_character(run_size);
+        }
+        m_mask_index += count;
+        m_next_index += count;
+    }
+
+    batch.blocks_owner = this;
+    return batch.size;
+}
+
+bool HashGenerator::_next_hybrid_word()
+{
+    m_current_word         = _next_word(m_wordlist->size());
+    m_word_block_mask_size = 0;
+    if (m_current_word.empty()) {
+        m_mask_index = m_keyspace->size();
+        m_next_index = get_end_index();
+        return false;
+    }
+
+    m_word_offset = m_current_word.data() - m_wordlist->get_data().data();
+    m_mask_index  = 0;
+    m_next_index  = m_word_offset * m_keyspace->size();
+    m_odometer->set(m_mask_begin);
+    return true;
+}
+
+void HashGenerator::_render_word_block(size_t mask_size)
+{
+    const auto word_position =
+        m_salt.size() + (m_mask_position == eMaskPosition::PREPEND ? mask_size : 0);
+    m_word_block           = m_message_templates[m_current_word.size() + mask_size];
+    m_word_block_mask_size = mask_size;
+    std::memcpy(m_word_block.bytes + word_position, m_current_word.data(), m_current_word.size());
+}
+
+void HashGenerator::_write_hybrid_permutation(sHashBatch &batch, size_t index)
+{
+    const auto mask             = m_odometer->get();
+    const auto permutation_size = m_current_word.size() + mask.size();
+
+    // Rare case, the permutation doesn't fit in a single block.
+    if (permutation_size >= m_message_templates.size()) {
+        _assign_hybrid_permutation(batch.long_permutations[index], m_current_word, mask);
+        _add_long_permutation(batch, index);
+        return;
+    }
+
+    if (mask.size() != m_word_block_mask_size) {
+        _render_word_block(mask.size());
+    }
+    auto &block            = batch.blocks[index];
+    auto permutation_bytes = reinterpret_cast<char *>(block.bytes + m_salt.size());
+    block                  = m_word_block;
+
+    // Usually a few characters, a call to memcpy would cost more.
+    auto mask_bytes = permutation_bytes +
+                      (m_mask_position == eMaskPosition::APPEND ? m_current_word.size() : 0);
+    for (size_t i = 0; i < mask.size(); ++i) {
+        mask_bytes[i] = mask[i];
+    }
+    batch.block_permutation_sizes[index] = static_cast<uint8_t>(permutation_size);
+    batch.permutations[index]            = {permutation_bytes, permutation_size};
+}
+
+void HashGenerator::_assign_hybrid_permutation(
+    std::string &permutation, std::string_view word, std::string_view mask) const
+{
+    if (m_mask_position == eMaskPosition::APPEND) {
+        permutation.assign(word).append(mask);
+    } else {
+        permutation.assign(mask).append(word);
+    }
+}
+
+void HashGenerator::_add_long_permutation(sHashBatch &batch, size_t index)
+{
+    batch.permutations[index] = batch.long_permutations[index];
+    batch.long_permutation_indices[batch.long_permutations_count++] = index;
+    batch.block_permutation_sizes[index] = sHashBatch::invalid_block_permutation_size;
+}
+
+void HashGenerator::_write_word(
+    sHashBatch &batch, size_t index, std::string_view word, const char *source_end)
+{
+    // Rare case, the word is copied since its source may change before the batch is hashed.
+    if (word.size() >= m_message_templates.size()) {
+        batch.long_permutations[index].assign(word);
+        _add_long_permutation(batch, index);
+        return;
+    }
+
+    auto &block            = batch.blocks[index];
+    auto permutation_bytes = reinterpret_cast<char *>(block.bytes + m_salt.size());
+    _copy_word(block, m_message_templates[word.size()], m_salt.size(), word, source_end);
+
+    batch.block_permutation_sizes[index] = static_cast<uint8_t>(word.size());
+    batch.permutations[index]            = {permutation_bytes, word.size()};
+}
+
+void HashGenerator::_copy_word(Sha256Engine::sBlock &block,
+    const Sha256Engine::sBlock &message_template, size_t position, std::string_view word,
+    const char *source_end)
+{
+    block           = message_template;
+    auto word_bytes = block.bytes + position;
+
+    // The words have random lengths, copy them with fixed size copies, which don't branch on the
+    // length: the word with the bytes after it in its source, then the end of the template over
+    // these bytes.
+    if (position + word.size() + word_copy_size <= sizeof(block.bytes) &&
+        word.data() + word_copy_size <= source_end) {
+        std::memcpy(word_bytes, word.data(), word_copy_size);
+        std::memcpy(word_bytes + word.size(), message_template.bytes + position + word.size(),
+            word_copy_size);
+    } else {
+        std::memcpy(word_bytes, word.data(), word.size());
+    }
+}
+
+void HashGenerator::_write_permutation(
+    sHashBatch &batch, size_t index, size_t block_changed_position)
+{
+    const auto permutation = m_odometer->get();
+
+    if (permutation.size() >= m_message_templates.size()) {
+        batch.long_permutations[index].assign(permutation);
+        _add_long_permutation(batch, index);
+        return;
+    }
+
+    auto permutation_bytes = _update_block(batch, index, permutation, block_changed_position);
+    if (!permutation.empty()) {
+        permutation_bytes[permutation.size() - 1] = permutation.back();
+    }
+}
+
+char *HashGenerator::_update_block(sHashBatch &batch, size_t index, std::string_view permutation,
+    size_t block_changed_position)
+{
+    const auto permutation_size = permutation.size();
+    auto &block                 = batch.blocks[index];
+    auto permutation_bytes      = reinterpret_cast<char *>(block.bytes + m_salt.size());
+
+    // The permutation view of the block is already in place when the size did not change.
+    if (batch.block_permutation_sizes[index] != permutation_size) {
+        block = m_message_templates[permutation_size];
+        std::memcpy(permutation_bytes, permutation.data(), permutation_size);
+        batch.block_permutation_sizes[index] = static_cast<uint8_t>(permutation_size);
+        batch.permutations[index]            = {permutation_bytes, permutation_size};
+        return permutation_bytes;
+    }
+
+    // Usually a single character, a call to memcpy would cost more.
+    for (size_t i = block_changed_position; i + 1 < permutation_size; ++i) {
+        permutation_bytes[i] = permutation[i];
+    }
+    return permutation_bytes;
+}
+
+void HashGenerator::_hash_long_permutations(sHashBatch &batch) const
+{
+    // Rare case, hash the long permutations with the streaming SHA-256.
+    for (size_t i = 0; i < batch.long_permutations_count; ++i) {
+        auto index = batch.long_permutation_indices[i];
+
+        SHA256 sha256;
+        sha256.add(m_salt.data(), m_salt.size());
+        sha256.add(batch.permutations[index].data(), batch.permutations[index].size());
+        sha256.add(m_pepper.data(), m_pepper.size());
+        sha256.getHash(batch.hashes[index].data());
+    }
+}
+
+void HashGenerator::_build_message_templates()
+{
+    // The padding takes at least 9 bytes: 0x80 terminator and 64 bits message length.
+    constexpr size_t max_message_size = sizeof(Sha256Engine::sBlock::bytes) - 9;
+
+    const size_t spice_size = m_salt.size() + m_pepper.size();
+    if (spice_size > max_message_size) {
+        return;
+    }
+
+    m_message_templates.resize(max_message_size - spice_size + 1);
+
+    for (size_t permutation_size = 0; permutation_size < m_message_templates.size();
+         ++permutation_size) {
+        auto &bytes = m_message_templates[permutation_size].bytes;
+        std::memset(bytes, 0, sizeof(bytes));
+
+        // The permutation characters are written between the salt and the pepper.
+        std::memcpy(bytes, m_salt.data(), m_salt.size());
+        std::memcpy(bytes + m_salt.size() + permutation_size, m_pepper.data(), m_pepper.size());
+
+        const size_t message_size = spice_size + permutation_size;
+        bytes[message_size]       = 0x80;
+
+        // Message length in bits, as a big endian 64 bits integer, at the end of the block.
+        const uint64_t message_bits = message_size * 8;
+        for (size_t i = 0; i < 8; ++i) {
+            bytes[sizeof(bytes) - 1 - i] = static_cast<uint8_t>(message_bits >> (i * 8));
+        }
+    }
 }
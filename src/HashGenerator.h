@@ -1,11 +1,62 @@
 
 #pragma once
 
+#include "CandidateOdometer.h"
+#include "Keyspace.h"
+#include "RuleSet.h"
+#include "Sha256Engine.h"
+#include "Wordlist.h"
+
 #include <array>
+#include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
 
+/**
+ * @brief A batch of consecutive permutations and their hashes, filled by
+ * @a HashGenerator::next_hashes().
+ */
+struct sHashBatch {
+    static constexpr size_t capacity = 64;
+
+    /**
+     * @brief Number of valid entries in the batch.
+     */
+    size_t size = 0;
+
+    /**
+     * @brief Views of the permutations. A permutation which fits in a single block is viewed
+     * inside its message block, otherwise inside @a long_permutations.
+     */
+    std::array<std::string_view, capacity> permutations;
+    std::array<Sha256Engine::sBlock, capacity> blocks;
+    std::array<Sha256Engine::Digest, capacity> hashes;
+
+    /**
+     * @brief Early reject words of the permutations, filled by
+     * @a HashGenerator::next_early_reject_words().
+     */
+    std::array<uint32_t, capacity> early_reject_words;
+
+    /**
+     * @brief Storage for the rare permutations which are too long to fit in a single block.
+     */
+    std::array<std::string, capacity> long_permutations;
+    std::array<uint8_t, capacity> long_permutation_indices;
+    size_t long_permutations_count = 0;
+
+    /**
+     * @brief The HashGenerator which filled the message blocks, and the size of the permutation in
+     * each block. Lets the HashGenerator write into a block only the characters which changed since
+     * the block was filled.
+     */
+    static constexpr uint8_t invalid_block_permutation_size = 0xff;
+    const void *blocks_owner = nullptr;
+    std::array<uint8_t, capacity> block_permutation_sizes;
+};
+
 /**
  * @brief The HashGenerator's responsibility is to take a range of string permutations and transform
  * each one of them into a hash in three simple steps:
@@ -14,10 +65,50 @@
  * <salt prefix string>Permutation<pepper suffix string>
  *
  * 2. Encrypt the spiced permutation with SHA-256.
+ *
+ * The permutations can be hashed one at a time with @a get_next_permutation_hash(), or in batches
+ * with @a next_hashes(). The batch API pads each spiced permutation into a single SHA-256 block and
+ * hashes the whole batch with the Sha256Engine, which uses the SIMD lanes of the CPU.
+ *
+ * Since the salt and the pepper are constant, the padded block of a permutation depends only on the
+ * permutation characters and its length. Therefore, a template block is prepared for each
+ * permutation length, with the salt, pepper, padding and message length already in place, and only
+ * the permutation characters are written on a copy of it.
+ *
+ * The permutations are enumerated by a CandidateOdometer, with no allocation and no character
+ * search. When the same batch is filled again, each block still holds the permutation a full batch
+ * earlier, of the same length in most cases. Only the characters which changed since then (usually
+ * the last two) are written into the block, and the template is copied only on a length change.
+ *
+ * In a wordlist attack, the permutations are the words of a Wordlist, read in place from its
+ * mapping and copied straight into the blocks. The keyspace indices are the byte offsets of the
+ * wordlist, see Wordlist. With a RuleSet, a window of words is loaded once, and each rule is
+ * applied to the whole window at a time, so each word is mangled by all the rules before the next
+ * window.
+ *
+ * In a hybrid attack, the permutations are the words of a Wordlist, each followed (or preceded) by
+ * each candidate of a mask keyspace. A word is rendered once into the template block of each
+ * length of the mask candidates, and only the mask characters are written on a copy of it. The
+ * index of a permutation is the offset of its word times the mask keyspace size, plus the index of
+ * its mask candidate, so a range of indices is a range of words times a range of mask candidates.
+ *
+ * In a combinator attack, the permutations are each word of a left Wordlist followed by each word
+ * of a right Wordlist. A left word is rendered once into the template block of each length of the
+ * right words, and only the right words are copied on a copy of it. The index of a permutation is
+ * the offset of its left word times the size of the right wordlist, plus the offset of its right
+ * word, so the ranges of indices partition the left wordlist.
  */
 
 class HashGenerator {
   public:
+    /**
+     * @brief Where the mask candidates go in a hybrid attack, after or before the words.
+     */
+    enum class eMaskPosition : uint8_t {
+        APPEND,
+        PREPEND,
+    };
+
     /**
      * @brief Construct a new Hash Generator object.
      *
@@ -28,34 +119,311 @@ class HashGenerator {
     HashGenerator(
         std::string_view salt, std::string_view pepper, std::string_view valid_characters);
 
+    /**
+     * @brief Construct a new Hash Generator object, with a keyspace bounded to a range of lengths.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param valid_characters List of valid characters to permute.
+     * @param min_permutation_size Minimal length of the permutations of the keyspace.
+     * @param max_permutation_size Maximal length of the permutations of the keyspace.
+     */
+    HashGenerator(std::string_view salt, std::string_view pepper,
+        std::string_view valid_characters, size_t min_permutation_size,
+        size_t max_permutation_size);
+
+    /**
+     * @brief Construct a new Hash Generator object for a mask attack, the permutations have the
+     * charset of the mask at each position.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param mask Charset of each position, see Mask.
+     * @param min_permutation_size Minimal length of the permutations of the keyspace.
+     * @param max_permutation_size Maximal length of the permutations of the keyspace.
+     */
+    HashGenerator(std::string_view salt, std::string_view pepper, const Mask &mask,
+        size_t min_permutation_size, size_t max_permutation_size);
+
+    /**
+     * @brief Construct a new Hash Generator object for a wordlist attack, the permutations are the
+     * words of @a wordlist.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param wordlist The words, shared with the other HashGenerators.
+     */
+    HashGenerator(
+        std::string_view salt, std::string_view pepper, std::shared_ptr<const Wordlist> wordlist);
+
+    /**
+     * @brief Construct a new Hash Generator object for a wordlist attack with rules, the
+     * permutations are the words of @a wordlist mangled by each of @a rules.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param wordlist The words, shared with the other HashGenerators.
+     * @param rules The rules, shared with the other HashGenerators, or null for the words as is.
+     * The words longer than @a RuleSet::max_word_size are skipped.
+     */
+    HashGenerator(std::string_view salt, std::string_view pepper,
+        std::shared_ptr<const Wordlist> wordlist, std::shared_ptr<const RuleSet> rules);
+
+    /**
+     * @brief Construct a new Hash Generator object for a hybrid attack, the permutations are each
+     * word of @a wordlist combined with each candidate of @a mask.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param wordlist The words, shared with the other HashGenerators.
+     * @param mask Charset of each position of the mask candidates, see Mask.
+     * @param min_mask_size Minimal length of the mask candidates.
+     * @param max_mask_size Maximal length of the mask candidates.
+     * @param mask_position Whether the mask candidates go after or before the words.
+     */
+    HashGenerator(std::string_view salt, std::string_view pepper,
+        std::shared_ptr<const Wordlist> wordlist, const Mask &mask, size_t min_mask_size,
+        size_t max_mask_size, eMaskPosition mask_position);
+
+    /**
+     * @brief Construct a new Hash Generator object for a combinator attack, the permutations are
+     * each word of @a left_wordlist followed by each word of @a right_wordlist.
+     *
+     * @param salt A string to prepend to each permutation.
+     * @param pepper A string to append to each permutation.
+     * @param left_wordlist The left words, shared with the other HashGenerators.
+     * @param right_wordlist The right words, shared with the other HashGenerators.
+     */
+    HashGenerator(std::string_view salt, std::string_view pepper,
+        std::shared_ptr<const Wordlist> left_wordlist,
+        std::shared_ptr<const Wordlist> right_wordlist);
+
     HashGenerator(HashGenerator &&hash_generator);
 
     /**
-     * @brief Overrides the current permutation @a m_current_permutation with a new one -
+     * @brief Overrides the current permutation @a m_odometer with a new one -
      * @a initial_permutation.
      *
      * @param initial_permutation
+     * @return true on success, false if @a initial_permutation is not valid, or in a wordlist
+     * attack.
+     */
+    bool set_initial_permutation(std::string_view initial_permutation);
+
+    /**
+     * @brief Set the permutation such that the next generated permutation is the one at @a index
+     * of the keyspace.
+     *
+     * @param index Index in the keyspace, see @a get_keyspace(), or offset in the wordlist. An
+     * offset is moved to the beginning of the next line, see Wordlist. In a hybrid attack, the
+     * offset times the mask keyspace size, plus the index of the mask candidate. In a combinator
+     * attack, the left offset times the right wordlist size, plus the right offset.
+     * @return true on success, false if @a index is out of the keyspace.
+     */
+    bool set_next_index(uint64_t index);
+
+    /**
+     * @brief Get the index of the next permutation, in the keyspace or in the wordlist. In a
+     * wordlist attack, it may be after the next word if there are empty lines in between. With
+     * rules, it is the offset of the window of words which are not mangled by all the rules yet.
      */
-    void set_initial_permutation(std::string_view initial_permutation);
+    uint64_t get_next_index() const { return m_next_index; }
+
+    /**
+     * @brief Get the end of the indices, the keyspace size or the wordlist size, or their product
+     * in a hybrid attack, or the product of the wordlists sizes in a combinator attack.
+     */
+    uint64_t get_end_index() const;
+
+    /**
+     * @brief Get the first permutation at or after @a index.
+     *
+     * @return std::optional containing the permutation, empty if there is none.
+     */
+    std::optional<std::string> get_candidate(uint64_t index) const;
+
+    /**
+     * @brief Get the keyspace, which numbers the permutations in the order they are generated. In
+     * a hybrid attack, the keyspace of the mask candidates of each word.
+     *
+     * @warning Brute force, mask and hybrid attacks only.
+     */
+    const Keyspace &get_keyspace() const { return *m_keyspace; }
 
     /**
      * @brief Increment the permutation to the next one, and construct a hash from that.
      *
-     * @return std::string A Hash of the next permutation.
+     * @return Sha256Engine::Digest A raw SHA-256 hash of the next permutation.
+     */
+    Sha256Engine::Digest get_next_permutation_hash();
+
+    /**
+     * @brief Increment the permutation up to @a max_count times, and hash all the new permutations
+     * in a single batch.
+     *
+     * @param batch Batch to fill with the permutations and their hashes.
+     * @param max_count Maximal number of indices to go through, i.e. of permutations to generate,
+     * capped to the batch capacity. In a wordlist attack, the words which start in the next
+     * @a max_count bytes, up to the batch capacity.
+     * @return size_t Number of permutations in the batch.
+     */
+    size_t next_hashes(sHashBatch &batch, size_t max_count = sHashBatch::capacity);
+
+    /**
+     * @brief Increment the permutation up to @a max_count times, and write the new permutations
+     * into the batch message blocks, without hashing them.
+     *
+     * @param batch Batch to fill with the permutations.
+     * @param max_count Maximal number of indices to go through, see @a next_hashes().
+     * @return size_t Number of permutations in the batch.
+     */
+    size_t next_permutations(sHashBatch &batch, size_t max_count = sHashBatch::capacity);
+
+    /**
+     * @brief Same as @a next_hashes(), but compute only the early reject words of the new
+     * permutations (see Sha256Engine), which is cheaper than computing the full hashes.
+     * Use @a complete_hash() to get the full hash of a permutation which was not rejected.
+     *
+     * @param batch Batch to fill with the permutations and their early reject words.
+     * @param max_count Maximal number of indices to go through, see @a next_hashes().
+     * @return size_t Number of permutations in the batch.
+     */
+    size_t next_early_reject_words(sHashBatch &batch, size_t max_count = sHashBatch::capacity);
+
+    /**
+     * @brief Compute the full hash of a permutation in a batch filled by
+     * @a next_early_reject_words().
+     *
+     * @param batch The batch.
+     * @param index Index of the permutation in the batch.
+     * @return const Sha256Engine::Digest& The hash, stored in the batch.
      */
-    std::string get_next_permutation_hash();
+    const Sha256Engine::Digest &complete_hash(sHashBatch &batch, size_t index) const;
 
     /**
      * @brief Get the current permutation string.
      *
      * @return std::string_view The current permutation.
      */
-    std::string_view get_current_permutation() { return m_current_permutation; }
+    std::string_view get_current_permutation()
+    {
+        if (_is_hybrid() || _is_combinator()) {
+            return m_current_permutation;
+        }
+        return m_wordlist ? m_current_word : m_odometer->get();
+    }
 
   private:
+    /**
+     * @brief Size of the fixed size copies of a word into its block, see @a _write_word().
+     */
+    static constexpr size_t word_copy_size = 32;
+
+    /**
+     * @brief Fill the batch with the words which start before @a end_offset in the wordlist.
+     */
+    size_t _next_words(sHashBatch &batch, uint64_t end_offset);
+
+    /**
+     * @brief Get the next non empty word which starts before @a end_offset, and advise the
+     * wordlist pages ahead of it.
+     *
+     * @return std::string_view The word, empty if there is none.
+     */
+    std::string_view _next_word(uint64_t end_offset);
+
+    /**
+     * @brief Get the next word mangled by a rule, from the window of words which start before
+     * @a end_offset.
+     *
+     * @return std::string_view The word, empty if there is none.
+     */
+    std::string_view _next_rule_word(uint64_t end_offset);
+
+    bool _is_hybrid() const { return m_wordlist && m_odometer; }
+
+    bool _is_combinator() const { return m_right_wordlist != nullptr; }
+
+    /**
+     * @brief Fill the batch with the hybrid permutations whose index is before @a end_index.
+     */
+    size_t _next_hybrid_permutations(sHashBatch &batch, uint64_t end_index);
+
+    /**
+     * @brief Move to the first mask candidate of the next word, in a hybrid attack.
+     *
+     * @return true on success, false if there is no word left.
+     */
+    bool _next_hybrid_word();
+
+    /**
+     * @brief Render the current word into @a m_word_block, for the mask candidates of
+     * @a mask_size characters.
+     */
+    void _render_word_block(size_t mask_size);
+
+    /**
+     * @brief Fill the batch with the combinator permutations whose index is before @a end_index.
+     */
+    size_t _next_combined_words(sHashBatch &batch, uint64_t end_index);
+
+    /**
+     * @brief Get the next right word, after the current left word, whose permutation index is
+     * before @a end_index. Moves to the next left word at the end of the right words.
+     *
+     * @return std::string_view The right word, empty if there is none.
+     */
+    std::string_view _next_right_word(uint64_t end_index);
+
+    /**
+     * @brief Move to the first right word of the next left word, in a combinator attack.
+     *
+     * @return true on success, false if there is no left word left.
+     */
+    bool _next_left_word();
+
+    /**
+     * @brief Write the current left word followed by @a right_word into the batch at @a index.
+     */
+    void _write_combined_word(sHashBatch &batch, size_t index, std::string_view right_word);
+
+    /**
+     * @brief Write the current word and mask candidate into the batch at @a index.
+     */
+    void _write_hybrid_permutation(sHashBatch &batch, size_t index);
+
+    /**
+     * @brief Set @a permutation to @a word combined with the mask candidate @a mask.
+     */
+    void _assign_hybrid_permutation(
+        std::string &permutation, std::string_view word, std::string_view mask) const;
+
+    /**
+     * @brief Add the permutation in @a batch.long_permutations at @a index to the permutations of
+     * the batch, to be hashed by @a _hash_long_permutations().
+     */
+    static void _add_long_permutation(sHashBatch &batch, size_t index);
+
+    /**
+     * @brief Write @a word into the batch at @a index.
+     *
+     * @param source_end End of the memory which holds @a word, which may be read past the word.
+     */
+    void _write_word(
+        sHashBatch &batch, size_t index, std::string_view word, const char *source_end);
+
+    /**
+     * @brief Set @a block to @a message_template with @a word at @a position.
+     *
+     * @param source_end End of the memory which holds @a word, which may be read past the word.
+     */
+    static void _copy_word(Sha256Engine::sBlock &block,
+        const Sha256Engine::sBlock &message_template, size_t position, std::string_view word,
+        const char *source_end);
+
     /**
      * @brief Construct a spiced permutation by adding @a m_salt as prefix, and @a m_pepper
-     * as suffix to @a m_current_permutation which holds the latest password permutation.
+     * as suffix to the latest password permutation.
      *
      * @return std::string of spiced permutation.
      */
@@ -65,12 +433,110 @@ class HashGenerator {
      * @brief Encrypt given password @a decrypted_password with SHA-256.
      *
      * @param decrypted_pass Password to encrypt.
-     * @return std::array<uint8_t, sha256_vector_size> containing the encrypted password.
+     * @return Sha256Engine::Digest containing the encrypted password.
      */
-    std::string _encrypt_password(std::string_view decrypted_password);
+    Sha256Engine::Digest _encrypt_password(std::string_view decrypted_password);
+
+    /**
+     * @brief Build the template blocks of all the permutation lengths which fit in a single block.
+     */
+    void _build_message_templates();
+
+    /**
+     * @brief Write the current permutation into the batch at @a index.
+     *
+     * @param batch The batch.
+     * @param index Index of the permutation in the batch.
+     * @param block_changed_position Leftmost position which may differ from the permutation in the
+     * block, if the block holds a permutation of the same size.
+     */
+    void _write_permutation(sHashBatch &batch, size_t index, size_t block_changed_position);
+
+    /**
+     * @brief Update the block at @a index to hold @a permutation, except its last character which
+     * the caller writes.
+     *
+     * @return char* The permutation characters in the block.
+     */
+    char *_update_block(sHashBatch &batch, size_t index, std::string_view permutation,
+        size_t block_changed_position);
+
+    /**
+     * @brief Hash the permutations of the batch which are too long to fit in a single block.
+     */
+    void _hash_long_permutations(sHashBatch &batch) const;
 
-    std::string m_current_permutation;
     const std::string m_salt;
     const std::string m_pepper;
-    const std::string m_valid_characters;
+    Sha256Engine m_sha256_engine;
+
+    /**
+     * @brief The generated permutations and their keyspace, in a brute force or mask attack.
+     */
+    std::optional<CandidateOdometer> m_odometer;
+    std::optional<Keyspace> m_keyspace;
+
+    /**
+     * @brief The words and the latest one, in a wordlist attack. The pages of the wordlist are
+     * advised ahead of the reading position once it reaches @a m_readahead_index.
+     */
+    std::shared_ptr<const Wordlist> m_wordlist;
+    const char *m_wordlist_end      = nullptr;
+    Wordlist::sCursor m_word_cursor = {};
+    std::string_view m_current_word;
+    uint64_t m_readahead_index = 0;
+
+    /**
+     * @brief The rules of a wordlist attack, if any. The current window of words, and its words
+     * mangled by the rule before @a m_rule_index, which are taken from @a m_rule_candidate_index.
+     */
+    std::shared_ptr<const RuleSet> m_rules;
+    std::unique_ptr<RuleSet::sWordBatch> m_rule_words;
+    std::unique_ptr<RuleSet::sWordBatch> m_rule_candidates;
+    size_t m_rule_index           = 0;
+    size_t m_rule_candidate_index = 0;
+
+    /**
+     * @brief The mask candidates of a hybrid attack go at @a m_mask_position of the current word,
+     * which is at @a m_word_offset in the wordlist. @a m_mask_index is the index of the next mask
+     * candidate of the word, and @a m_mask_begin is the candidate before the first one. The word is
+     * rendered into @a m_word_block, for the mask candidates of @a m_word_block_mask_size
+     * characters, 0 until it is rendered.
+     */
+    eMaskPosition m_mask_position = eMaskPosition::APPEND;
+    uint64_t m_word_offset        = 0;
+    uint64_t m_mask_index         = 0;
+    std::string m_mask_begin;
+    Sha256Engine::sBlock m_word_block = {};
+    size_t m_word_block_mask_size     = 0;
+    std::string m_current_permutation;
+
+    /**
+     * @brief The right words of a combinator attack, and the position of the next one after the
+     * current left word, which is @a m_current_word at @a m_word_offset. The left word is rendered
+     * into @a m_left_word_blocks, indexed by the right word length, for the lengths set in the
+     * bitmask @a m_left_word_block_sizes.
+     */
+    std::shared_ptr<const Wordlist> m_right_wordlist;
+    const char *m_right_wordlist_end = nullptr;
+    Wordlist::sCursor m_right_cursor = {};
+    std::vector<Sha256Engine::sBlock> m_left_word_blocks;
+    uint64_t m_left_word_block_sizes = 0;
+
+    /**
+     * @brief Index of the next permutation, see @a get_next_index().
+     */
+    uint64_t m_next_index = 0;
+
+    /**
+     * @brief Template message blocks, indexed by the permutation length.
+     */
+    std::vector<Sha256Engine::sBlock> m_message_templates;
+
+    /**
+     * @brief The batch filled by the previous call, if it was filled to capacity, and the
+     * leftmost position changed by the permutation increments of that call.
+     */
+    const sHashBatch *m_last_batch       = nullptr;
+    size_t m_last_batch_changed_position = 0;
 };
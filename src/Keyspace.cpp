@@ -0,0 +1,118 @@
+#include "Keyspace.h"
+
+#include <algorithm>
+#include <limits>
+
+Keyspace::Keyspace(std::string_view base_characters, size_t min_size, size_t max_size) :
+    Keyspace(Mask::from_charset(base_characters), min_size, max_size)
+{
+}
+
+Keyspace::Keyspace(const Mask &mask, size_t min_size, size_t max_size) :
+    m_mask(mask), m_min_size(std::max<size_t>(min_size, 1))
+{
+    for (const auto &charset : m_mask.get_charsets()) {
+        auto &digit_of_character = m_digit_of_character.emplace_back();
+        digit_of_character.fill(invalid_digit);
+        for (size_t digit = 0; digit < charset.size(); ++digit) {
+            digit_of_character[static_cast<uint8_t>(charset[digit])] = static_cast<uint8_t>(digit);
+        }
+    }
+
+    // Add the lengths as long as the indices of all their candidates fit in 64 bits.
+    constexpr auto max_index  = std::numeric_limits<uint64_t>::max();
+    uint64_t candidates_count = 1;
+    m_first_indices.push_back(0);
+
+    max_size = std::min(max_size, m_mask.size());
+    for (size_t length = 1; length <= max_size; ++length) {
+        const uint64_t base = m_mask.get_charset(length - 1).size();
+        if (candidates_count > max_index / base) {
+            break;
+        }
+        candidates_count *= base;
+
+        if (length < m_min_size) {
+            continue;
+        }
+        if (m_first_indices.back() > max_index - candidates_count) {
+            break;
+        }
+        m_first_indices.push_back(m_first_indices.back() + candidates_count);
+    }
+}
+
+uint64_t Keyspace::get_first_index(size_t candidate_size) const
+{
+    if (candidate_size < m_min_size) {
+        return 0;
+    }
+    if (candidate_size > get_max_size()) {
+        return size();
+    }
+    return m_first_indices[candidate_size - m_min_size];
+}
+
+size_t Keyspace::get_candidate_size(uint64_t index) const
+{
+    size_t length_index = 0;
+    while (index >= m_first_indices[length_index + 1]) {
+        ++length_index;
+    }
+    return m_min_size + length_index;
+}
+
+std::optional<std::string> Keyspace::get_candidate(uint64_t index) const
+{
+    if (index >= size()) {
+        return std::nullopt;
+    }
+
+    // The offset in the length is the candidate as a fixed width mixed radix integer, the radix
+    // of each position is the size of its charset.
+    std::string candidate(get_candidate_size(index), '\0');
+    uint64_t offset = index - m_first_indices[candidate.size() - m_min_size];
+    for (size_t position = candidate.size(); position-- > 0;) {
+        const auto charset  = m_mask.get_charset(position);
+        candidate[position] = charset[offset % charset.size()];
+        offset /= charset.size();
+    }
+
+    return candidate;
+}
+
+std::optional<std::string> Keyspace::get_previous_candidate(uint64_t index) const
+{
+    // The first candidate follows the last candidate of the shorter length.
+    if (index == 0) {
+        std::string candidate(m_min_size - 1, '\0');
+        for (size_t position = 0; position < candidate.size(); ++position) {
+            candidate[position] = m_mask.get_charset(position).back();
+        }
+        return candidate;
+    }
+    if (index > size()) {
+        return std::nullopt;
+    }
+    return get_candidate(index - 1);
+}
+
+std::optional<uint64_t> Keyspace::get_index(std::string_view candidate) const
+{
+    if (candidate.size() < m_min_size || candidate.size() > get_max_size()) {
+        return std::nullopt;
+    }
+
+    uint64_t offset = 0;
+    for (size_t position = 0; position < candidate.size(); ++position) {
+        const auto charset_index = m_mask.get_charset_index(position);
+        const auto digit =
+            m_digit_of_character[charset_index][static_cast<uint8_t>(candidate[position])];
+        if (digit == invalid_digit) {
+            return std::nullopt;
+        }
+        offset = offset * m_mask.get_charset(position).size() + digit;
+    }
+
+    return m_first_indices[candidate.size() - m_min_size] + offset;
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Mask.h"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The Keyspace numbers the password candidates, so a range of candidates is a plain range
+ * of 64 bits indices.
+ *
+ * @details The candidates are ordered by length, and the candidates of the same length are ordered
+ * as fixed width base X integers, e.g. with "abc": "a", "b", "c", "aa", "ab", ..., "cc", "aaa", ...
+ * With a mask (see Mask), each position has its own charset, and the candidates of the same length
+ * are mixed radix integers. This is the order of CandidateOdometer.
+ *
+ * The index of the first candidate of each length is precomputed, so an index is converted to its
+ * candidate, and back, with one base conversion of the length of the candidate.
+ *
+ * The keyspace may be bounded to a range of lengths, the size of each length is exact, so the work
+ * can be split and scheduled per length. Only the lengths whose candidates all fit in 64 bits
+ * indices are part of the keyspace, e.g. up to 12 characters with 36 base characters.
+ *
+ * @example
+ *
+ * Keyspace keyspace("abc");
+ * keyspace.get_candidate(4);  // "ab"
+ * keyspace.get_index("ab");   // 4
+ */
+
+class Keyspace {
+  public:
+    /**
+     * @brief Construct a new Keyspace object.
+     *
+     * @param base_characters Characters of the base, at least 2 and at most 256 unique characters.
+     * @param min_size Minimal length of a candidate, at least 1 since the empty candidate is not
+     * part of the keyspace.
+     * @param max_size Maximal length of a candidate, lowered to the longest length that fits.
+     */
+    explicit Keyspace(
+        std::string_view base_characters, size_t min_size = 1, size_t max_size = Mask::max_size);
+
+    /**
+     * @brief Construct a new Keyspace object of a mask.
+     *
+     * @param mask Charset of each position.
+     * @param min_size Minimal length of a candidate, at least 1.
+     * @param max_size Maximal length of a candidate, lowered to the mask length and to the longest
+     * length that fits.
+     */
+    Keyspace(const Mask &mask, size_t min_size, size_t max_size);
+
+    /**
+     * @brief Get the minimal length of a candidate.
+     */
+    size_t get_min_size() const { return m_min_size; }
+
+    /**
+     * @brief Get the number of candidates in the keyspace, the end of the indices range.
+     */
+    uint64_t size() const { return m_first_indices.back(); }
+
+    /**
+     * @brief Get the maximal length of a candidate.
+     */
+    size_t get_max_size() const { return m_min_size + m_first_indices.size() - 2; }
+
+    /**
+     * @brief Get the index of the first candidate of @a candidate_size characters, 0 if it is
+     * shorter than the minimal length, or the keyspace size if it is longer than the maximal
+     * length.
+     */
+    uint64_t get_first_index(size_t candidate_size) const;
+
+    /**
+     * @brief Get the length of the candidate at @a index, which must be in the keyspace.
+     */
+    size_t get_candidate_size(uint64_t index) const;
+
+    /**
+     * @brief Get the candidate at @a index.
+     *
+     * @return std::optional containing the candidate, empty if @a index is out of the keyspace.
+     */
+    std::optional<std::string> get_candidate(uint64_t index) const;
+
+    /**
+     * @brief Get the candidate which precedes the one at @a index, i.e. the one that a
+     * CandidateOdometer should be set to, so its next increment gives the candidate at @a index.
+     *
+     * @param index Index in the keyspace, or the keyspace size.
+     * @return std::optional containing the candidate, empty if @a index is out of the keyspace.
+     */
+    std::optional<std::string> get_previous_candidate(uint64_t index) const;
+
+    /**
+     * @brief Get the index of @a candidate.
+     *
+     * @return std::optional containing the index, empty if @a candidate is not in the keyspace.
+     */
+    std::optional<uint64_t> get_index(std::string_view candidate) const;
+
+  private:
+    static constexpr uint8_t invalid_digit = 0xff;
+
+    Mask m_mask;
+    size_t m_min_size;
+
+    /**
+     * @brief The digit of each character, for each charset of the mask.
+     */
+    std::vector<std::array<uint8_t, 256>> m_digit_of_character;
+
+    /**
+     * @brief Index of the first candidate of each length from @a m_min_size, followed by the
+     * keyspace size.
+     */
+    std::vector<uint64_t> m_first_indices;
+};
@@ -0,0 +1,246 @@
+#include "KeyspaceScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+uint64_t get_range_size(uint64_t begin_index, uint64_t end_index)
+{
+    return end_index > begin_index ? end_index - begin_index : 0;
+}
+
+} // namespace
+
+KeyspaceScheduler::KeyspaceScheduler(const Keyspace &keyspace, uint64_t begin_index,
+    uint64_t end_index, size_t workers_count, eDistribution distribution) :
+    m_size(get_range_size(begin_index, std::min(end_index, keyspace.size()))),
+    m_workers_count(std::max<size_t>(workers_count, 1)), m_distribution(distribution),
+    m_queues(std::make_unique<sWorkerQueue[]>(m_workers_count))
+{
+    if (distribution == eDistribution::CONTIGUOUS) {
+        _distribute({begin_index, begin_index + m_size});
+    } else {
+        // Each worker's deque holds its share of each length, the shortest length in front.
+        for (auto length = keyspace.get_min_size(); length <= keyspace.get_max_size(); ++length) {
+            const auto length_begin = std::max(begin_index, keyspace.get_first_index(length));
+            const auto length_end   = std::min(end_index, keyspace.get_first_index(length + 1));
+            if (length_begin < length_end) {
+                if (length_begin > begin_index) {
+                    m_length_begins.push_back(length_begin);
+                }
+                _distribute({length_begin, length_end});
+            }
+        }
+    }
+
+    // A chunk is taken from a single range, cut the ranges at the lengths boundaries so all the
+    // candidates of a chunk have the same length.
+    for (size_t worker_index = 0; worker_index < m_workers_count; ++worker_index) {
+        auto &ranges = m_queues[worker_index].ranges;
+        std::deque<sChunk> length_ranges;
+        for (auto range : ranges) {
+            while (range.begin < range.end) {
+                const auto length = keyspace.get_candidate_size(range.begin);
+                const auto end    = std::min(range.end, keyspace.get_first_index(length + 1));
+                length_ranges.push_back({range.begin, end});
+                range.begin = end;
+            }
+        }
+        ranges = std::move(length_ranges);
+        _update_front_length_rank(m_queues[worker_index]);
+    }
+}
+
+KeyspaceScheduler::KeyspaceScheduler(
+    uint64_t begin_index, uint64_t end_index, size_t workers_count) :
+    m_size(get_range_size(begin_index, end_index)),
+    m_workers_count(std::max<size_t>(workers_count, 1)),
+    m_distribution(eDistribution::CONTIGUOUS),
+    m_queues(std::make_unique<sWorkerQueue[]>(m_workers_count))
+{
+    _distribute({begin_index, begin_index + m_size});
+    for (size_t worker_index = 0; worker_index < m_workers_count; ++worker_index) {
+        _update_front_length_rank(m_queues[worker_index]);
+    }
+}
+
+std::optional<KeyspaceScheduler::sChunk> KeyspaceScheduler::next_chunk(
+    size_t worker_index, uint64_t max_size)
+{
+    auto &queue = m_queues[worker_index];
+    max_size    = std::max<uint64_t>(max_size, 1);
+
+    // Help with a shorter length before taking a chunk of a longer one.
+    auto steal = [&]() {
+        return m_distribution == eDistribution::LENGTH_MAJOR ? _steal_shortest(worker_index)
+                                                             : _steal(worker_index);
+    };
+    if (m_distribution == eDistribution::LENGTH_MAJOR) {
+        _steal_shortest(worker_index);
+    }
+
+    do {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.ranges.empty()) {
+            continue;
+        }
+
+        auto &range = queue.ranges.front();
+        sChunk chunk{range.begin, range.begin + std::min(max_size, range.end - range.begin)};
+        range.begin = chunk.end;
+        if (range.begin == range.end) {
+            queue.ranges.pop_front();
+            _update_front_length_rank(queue);
+        }
+        queue.remaining_count -= chunk.end - chunk.begin;
+
+        return chunk;
+    } while (steal());
+
+    return std::nullopt;
+}
+
+void KeyspaceScheduler::complete_chunk(const sChunk &chunk)
+{
+    m_completed_count += chunk.end - chunk.begin;
+}
+
+bool KeyspaceScheduler::_steal(size_t worker_index)
+{
+    while (true) {
+        // The victim is the worker with the most remaining work, its estimate may be outdated.
+        size_t victim_index       = worker_index;
+        uint64_t victim_remaining = 0;
+        for (size_t i = 0; i < m_workers_count; ++i) {
+            const auto remaining = m_queues[i].remaining_count.load(std::memory_order_relaxed);
+            if (i != worker_index && remaining > victim_remaining) {
+                victim_index     = i;
+                victim_remaining = remaining;
+            }
+        }
+        if (victim_index == worker_index) {
+            return false;
+        }
+
+        sChunk stolen;
+        {
+            auto &victim = m_queues[victim_index];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.ranges.empty()) {
+                // Taken by its owner or by another thief meanwhile, look again.
+                continue;
+            }
+
+            // Take the back half, the owner keeps working on the front.
+            auto &range = victim.ranges.back();
+            stolen      = {range.end - (range.end - range.begin + 1) / 2, range.end};
+            range.end   = stolen.begin;
+            if (range.begin == range.end) {
+                victim.ranges.pop_back();
+                _update_front_length_rank(victim);
+            }
+            victim.remaining_count -= stolen.end - stolen.begin;
+        }
+
+        auto &queue = m_queues[worker_index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.ranges.push_back(stolen);
+        _update_front_length_rank(queue);
+        queue.remaining_count += stolen.end - stolen.begin;
+        ++m_steals_count;
+
+        return true;
+    }
+}
+
+bool KeyspaceScheduler::_steal_shortest(size_t worker_index)
+{
+    auto &queue = m_queues[worker_index];
+    while (true) {
+        // The victim is the worker with the shortest front length, and the most remaining work
+        // among them, its estimates may be outdated.
+        const auto own_rank       = queue.front_length_rank.load(std::memory_order_relaxed);
+        size_t victim_index       = worker_index;
+        size_t victim_rank        = own_rank;
+        uint64_t victim_remaining = 0;
+        for (size_t i = 0; i < m_workers_count; ++i) {
+            const auto rank      = m_queues[i].front_length_rank.load(std::memory_order_relaxed);
+            const auto remaining = m_queues[i].remaining_count.load(std::memory_order_relaxed);
+            if (i != worker_index && (rank < victim_rank ||
+                                         (rank == victim_rank && victim_index != worker_index &&
+                                             remaining > victim_remaining))) {
+                victim_index     = i;
+                victim_rank      = rank;
+                victim_remaining = remaining;
+            }
+        }
+        if (victim_index == worker_index) {
+            return false;
+        }
+
+        sChunk stolen;
+        {
+            auto &victim = m_queues[victim_index];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.ranges.empty() ||
+                _get_length_rank(victim.ranges.front().begin) >= own_rank) {
+                // Taken by its owner or by another thief meanwhile, look again.
+                continue;
+            }
+
+            // Take the back half of the front range, the owner keeps working on its front.
+            auto &range = victim.ranges.front();
+            stolen      = {range.end - (range.end - range.begin + 1) / 2, range.end};
+            range.end   = stolen.begin;
+            if (range.begin == range.end) {
+                victim.ranges.pop_front();
+                _update_front_length_rank(victim);
+            }
+            victim.remaining_count -= stolen.end - stolen.begin;
+        }
+
+        // The stolen range is shorter than all the ranges of the deque, or was cut from the same
+        // length by another thief, keep the deque sorted.
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.ranges.insert(std::upper_bound(queue.ranges.begin(), queue.ranges.end(), stolen,
+                                [](const sChunk &left, const sChunk &right) {
+                                    return left.begin < right.begin;
+                                }),
+            stolen);
+        _update_front_length_rank(queue);
+        queue.remaining_count += stolen.end - stolen.begin;
+        ++m_steals_count;
+
+        return true;
+    }
+}
+
+size_t KeyspaceScheduler::_get_length_rank(uint64_t index) const
+{
+    return std::upper_bound(m_length_begins.begin(), m_length_begins.end(), index) -
+           m_length_begins.begin();
+}
+
+void KeyspaceScheduler::_update_front_length_rank(sWorkerQueue &queue) const
+{
+    queue.front_length_rank.store(
+        queue.ranges.empty() ? no_length_rank : _get_length_rank(queue.ranges.front().begin),
+        std::memory_order_relaxed);
+}
+
+void KeyspaceScheduler::_distribute(const sChunk &range)
+{
+    // The first workers take the remainder.
+    const uint64_t share     = (range.end - range.begin) / m_workers_count;
+    const uint64_t remainder = (range.end - range.begin) % m_workers_count;
+    uint64_t begin           = range.begin;
+
+    for (size_t worker_index = 0; worker_index < m_workers_count; ++worker_index) {
+        const uint64_t end = begin + share + (worker_index < remainder ? 1 : 0);
+        if (end > begin) {
+            m_queues[worker_index].ranges.push_back({begin, end});
+            m_queues[worker_index].remaining_count += end - begin;
+        }
+        begin = end;
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "Keyspace.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief The KeyspaceScheduler hands out chunks of a keyspace indices range (see Keyspace) to the
+ * HashCrackerThreads, until the whole range is done.
+ *
+ * @details The range is split evenly between the workers up front, each worker has a deque of
+ * ranges. The split follows one of the distributions:
+ * - CONTIGUOUS: each worker gets one contiguous share of the range. The first worker alone walks
+ *   the shortest candidates.
+ * - LENGTH_MAJOR: the range is cut at the lengths boundaries of the keyspace, and each length is
+ *   split evenly, so each worker's deque holds its share of each length, the shortest in front.
+ *
+ * Then:
+ * - A worker takes its chunks from the front of its own deque. The chunk size is chosen by the
+ *   worker, so a fast worker and a slow worker take chunks of the same duration.
+ * - CONTIGUOUS: a worker whose deque is empty steals half of the back range of the worker with the
+ *   most remaining indices, so no worker idles while there is work left anywhere.
+ * - LENGTH_MAJOR: the front lengths of the deques are a shared frontier. Before a worker takes a
+ *   chunk of a length, or when its deque is empty, it steals half of the front range of the worker
+ *   with the shortest front length, if it is shorter than its own. So no worker moves to the next
+ *   length while the current one has unclaimed work: all the workers cooperate on the short
+ *   candidates, which are the most likely passwords, and a fast worker helps the slow ones with
+ *   them instead of running ahead on longer candidates.
+ *
+ * A range of indices with no lengths, such as the offsets of a Wordlist, is split contiguously.
+ *
+ * Each deque has its own lock, which is taken once per chunk and is almost never contended. A
+ * worker only waits on another worker's lock when it steals.
+ *
+ * @example
+ *
+ * auto scheduler = std::make_shared<KeyspaceScheduler>(keyspace, 0, keyspace.size(),
+ *     workers_count, KeyspaceScheduler::eDistribution::LENGTH_MAJOR);
+ *
+ * // Worker thread
+ * while (auto chunk = scheduler->next_chunk(worker_index, chunk_size)) {
+ *     crack(chunk->begin, chunk->end);
+ *     scheduler->complete_chunk(*chunk);
+ * }
+ */
+
+class KeyspaceScheduler {
+  public:
+    /**
+     * @brief How the range is split between the workers, see the class description.
+     */
+    enum class eDistribution : uint8_t {
+        CONTIGUOUS,
+        LENGTH_MAJOR,
+    };
+
+    /**
+     * @brief A range of keyspace indices [begin, end).
+     */
+    struct sChunk {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    /**
+     * @brief Construct a new KeyspaceScheduler object.
+     *
+     * @param keyspace The keyspace of the indices.
+     * @param begin_index First index of the range to schedule.
+     * @param end_index End of the range to schedule, clamped to the keyspace size.
+     * @param workers_count Number of workers, at least 1.
+     * @param distribution How the range is split between the workers.
+     */
+    KeyspaceScheduler(const Keyspace &keyspace, uint64_t begin_index, uint64_t end_index,
+        size_t workers_count, eDistribution distribution = eDistribution::CONTIGUOUS);
+
+    /**
+     * @brief Construct a new KeyspaceScheduler object of a plain range of indices, e.g. the
+     * offsets of a Wordlist.
+     *
+     * @param begin_index First index of the range to schedule.
+     * @param end_index End of the range to schedule.
+     * @param workers_count Number of workers, at least 1.
+     */
+    KeyspaceScheduler(uint64_t begin_index, uint64_t end_index, size_t workers_count);
+
+    /**
+     * @brief Take the next chunk of @a worker_index, from its own deque, or stolen from another
+     * worker if its deque is empty. Thread safe.
+     *
+     * @param worker_index Index of the worker, less than the workers count.
+     * @param max_size Maximal size of the chunk, at least 1.
+     * @return std::optional containing the chunk, empty if no work is left to schedule.
+     */
+    std::optional<sChunk> next_chunk(size_t worker_index, uint64_t max_size);
+
+    /**
+     * @brief Report that a chunk given by @a next_chunk() is done. Thread safe.
+     */
+    void complete_chunk(const sChunk &chunk);
+
+    /**
+     * @brief Get the size of the scheduled range.
+     */
+    uint64_t size() const { return m_size; }
+
+    /**
+     * @brief Get the number of indices in the completed chunks.
+     */
+    uint64_t get_completed_count() const { return m_completed_count.load(); }
+
+    /**
+     * @brief Returns true once all the chunks of the range are completed.
+     */
+    bool is_done() const { return get_completed_count() == m_size; }
+
+    /**
+     * @brief Get the number of successful steals.
+     */
+    uint64_t get_steals_count() const { return m_steals_count.load(); }
+
+  private:
+    /**
+     * @brief Length rank of an empty deque, after all the lengths.
+     */
+    static constexpr size_t no_length_rank = SIZE_MAX;
+
+    /**
+     * @brief The ranges of a worker, sorted by index, and the number of indices in them, and the
+     * length rank of its front range (see @a _get_length_rank()). The remaining count and the
+     * front length rank are updated under the lock, and read without it to choose a victim to
+     * steal from.
+     */
+    struct alignas(64) sWorkerQueue {
+        std::mutex mutex;
+        std::deque<sChunk> ranges;
+        std::atomic<uint64_t> remaining_count = 0;
+        std::atomic<size_t> front_length_rank = no_length_rank;
+    };
+
+    /**
+     * @brief Move half of the back range of the worker with the most remaining indices to the
+     * deque of @a worker_index.
+     *
+     * @return true if anything was stolen, otherwise false.
+     */
+    bool _steal(size_t worker_index);
+
+    /**
+     * @brief Move half of the front range of the worker with the shortest front length to the
+     * front of the deque of @a worker_index, if it is shorter than the front length of
+     * @a worker_index.
+     *
+     * @return true if anything was stolen, otherwise false.
+     */
+    bool _steal_shortest(size_t worker_index);
+
+    /**
+     * @brief Get the rank of the length of the candidate at @a index among the lengths of the
+     * range, 0 for the shortest length. Always 0 with the CONTIGUOUS distribution.
+     */
+    size_t _get_length_rank(uint64_t index) const;
+
+    /**
+     * @brief Update the front length rank of @a queue after a change of its ranges. Should be
+     * called under its lock.
+     */
+    void _update_front_length_rank(sWorkerQueue &queue) const;
+
+    /**
+     * @brief Split @a range evenly, and append the shares to the workers deques.
+     */
+    void _distribute(const sChunk &range);
+
+    const uint64_t m_size;
+    const size_t m_workers_count;
+    const eDistribution m_distribution;
+
+    /**
+     * @brief The first index of each length of the range but the shortest, in increasing order,
+     * with the LENGTH_MAJOR distribution, empty otherwise.
+     */
+    std::vector<uint64_t> m_length_begins;
+
+    std::unique_ptr<sWorkerQueue[]> m_queues;
+
+    std::atomic<uint64_t> m_completed_count = 0;
+    std::atomic<uint64_t> m_steals_count    = 0;
+};
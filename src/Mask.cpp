@@ -0,0 +1,163 @@
+#include "Mask.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+namespace {
+
+constexpr std::string_view lower_charset  = "abcdefghijklmnopqrstuvwxyz";
+constexpr std::string_view upper_charset  = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+constexpr std::string_view digit_charset  = "0123456789";
+constexpr std::string_view symbol_charset = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+/**
+ * @brief Get the built-in charset of @a placeholder (the character after '?').
+ */
+std::optional<std::string> get_builtin_charset(char placeholder)
+{
+    switch (placeholder) {
+    case 'l':
+        return std::string(lower_charset);
+    case 'u':
+        return std::string(upper_charset);
+    case 'd':
+        return std::string(digit_charset);
+    case 's':
+        return std::string(symbol_charset);
+    case 'a':
+        return std::string(lower_charset)
+            .append(upper_charset)
+            .append(digit_charset)
+            .append(symbol_charset);
+    case '?':
+        return std::string("?");
+    default:
+        return std::nullopt;
+    }
+}
+
+/**
+ * @brief Append the characters of @a charset which are not in @a unique_charset yet.
+ */
+void append_unique(std::string &unique_charset, std::string_view charset)
+{
+    for (auto character : charset) {
+        if (unique_charset.find(character) == std::string::npos) {
+            unique_charset += character;
+        }
+    }
+}
+
+/**
+ * @brief Expand the built-in charsets used in a custom charset.
+ */
+std::optional<std::string> expand_custom_charset(std::string_view custom_charset)
+{
+    std::string charset;
+    for (size_t i = 0; i < custom_charset.size(); ++i) {
+        if (custom_charset[i] != '?') {
+            append_unique(charset, custom_charset.substr(i, 1));
+            continue;
+        }
+
+        auto builtin_charset =
+            i + 1 < custom_charset.size() ? get_builtin_charset(custom_charset[++i]) : std::nullopt;
+        if (!builtin_charset) {
+            std::cerr << "Invalid placeholder in custom charset \"" << custom_charset << "\"\n";
+            return std::nullopt;
+        }
+        append_unique(charset, *builtin_charset);
+    }
+
+    return charset;
+}
+
+} // namespace
+
+Mask Mask::from_charset(std::string_view charset)
+{
+    Mask mask;
+    mask.m_charsets.emplace_back(charset);
+    mask.m_position_charsets.assign(max_size, 0);
+    return mask;
+}
+
+std::optional<Mask> Mask::parse(
+    std::string_view mask, const std::vector<std::string> &custom_charsets)
+{
+    if (custom_charsets.size() > max_custom_charsets) {
+        std::cerr << "Too many custom charsets: " << custom_charsets.size() << ", maximum is "
+                  << max_custom_charsets << "\n";
+        return std::nullopt;
+    }
+
+    // An empty custom charset is undefined, it is an error only if the mask uses it.
+    std::vector<std::string> expanded_custom_charsets;
+    for (const auto &custom_charset : custom_charsets) {
+        if (custom_charset.empty()) {
+            expanded_custom_charsets.emplace_back();
+            continue;
+        }
+        auto charset = expand_custom_charset(custom_charset);
+        if (!charset) {
+            return std::nullopt;
+        }
+        expanded_custom_charsets.push_back(std::move(*charset));
+    }
+
+    Mask parsed_mask;
+    for (size_t i = 0; i < mask.size(); ++i) {
+        if (parsed_mask.size() == max_size) {
+            std::cerr << "Mask \"" << mask << "\" is longer than " << max_size << "\n";
+            return std::nullopt;
+        }
+
+        if (mask[i] != '?') {
+            parsed_mask._add_position(std::string(1, mask[i]));
+            continue;
+        }
+
+        if (i + 1 == mask.size()) {
+            std::cerr << "Mask \"" << mask << "\" ends with a '?'\n";
+            return std::nullopt;
+        }
+        const char placeholder = mask[++i];
+
+        // ?1 to ?4
+        const size_t custom_index = placeholder - '1';
+        if (placeholder >= '1' && custom_index < max_custom_charsets) {
+            if (custom_index >= expanded_custom_charsets.size() ||
+                expanded_custom_charsets[custom_index].empty()) {
+                std::cerr << "Mask \"" << mask << "\" uses the undefined custom charset ?"
+                          << placeholder << "\n";
+                return std::nullopt;
+            }
+            parsed_mask._add_position(expanded_custom_charsets[custom_index]);
+            continue;
+        }
+
+        auto builtin_charset = get_builtin_charset(placeholder);
+        if (!builtin_charset) {
+            std::cerr << "Mask \"" << mask << "\" has an invalid placeholder ?" << placeholder
+                      << "\n";
+            return std::nullopt;
+        }
+        parsed_mask._add_position(*builtin_charset);
+    }
+
+    if (parsed_mask.size() == 0) {
+        std::cerr << "Empty mask\n";
+        return std::nullopt;
+    }
+    return parsed_mask;
+}
+
+void Mask::_add_position(const std::string &charset)
+{
+    auto charset_iterator = std::find(m_charsets.begin(), m_charsets.end(), charset);
+    if (charset_iterator == m_charsets.end()) {
+        charset_iterator = m_charsets.insert(m_charsets.end(), charset);
+    }
+    m_position_charsets.push_back(static_cast<uint8_t>(charset_iterator - m_charsets.begin()));
+}
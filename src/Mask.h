@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The Mask holds the charset of each position of the password candidates.
+ *
+ * @details A brute force attack uses the same charset at every position, see @a from_charset(). A
+ * mask attack uses a charset per position, parsed from a mask such as "?u?l?l?l?d?d?d?d":
+ * - ?l: "abcdefghijklmnopqrstuvwxyz"
+ * - ?u: "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+ * - ?d: "0123456789"
+ * - ?s: the printable ASCII symbols, including space
+ * - ?a: ?l?u?d?s
+ * - ?1 to ?4: custom charsets, which may themselves use the built-in charsets, e.g. "?l?d_"
+ * - ??: the character '?'
+ * - Any other character is a position with that single character.
+ *
+ * The distinct charsets are kept once, and each position refers to its charset by index.
+ *
+ * @example
+ *
+ * auto mask = Mask::parse("?1?l?l?d", {"?u#"});
+ * mask->get_charset(0); // "ABCDEFGHIJKLMNOPQRSTUVWXYZ#"
+ */
+
+class Mask {
+  public:
+    /**
+     * @brief Maximal number of positions.
+     */
+    static constexpr size_t max_size = 64;
+
+    /**
+     * @brief Maximal number of custom charsets, ?1 to ?4.
+     */
+    static constexpr size_t max_custom_charsets = 4;
+
+    /**
+     * @brief Get a mask with @a charset at each of the @a max_size positions.
+     *
+     * @param charset At least 1 and at most 256 unique characters.
+     */
+    static Mask from_charset(std::string_view charset);
+
+    /**
+     * @brief Parse a mask.
+     *
+     * @param mask The mask, see the class description.
+     * @param custom_charsets Custom charsets ?1 to ?4, at most @a max_custom_charsets. An empty
+     * custom charset is undefined.
+     * @return std::optional containing the mask, empty if it is invalid.
+     */
+    static std::optional<Mask> parse(
+        std::string_view mask, const std::vector<std::string> &custom_charsets = {});
+
+    /**
+     * @brief Get the number of positions.
+     */
+    size_t size() const { return m_position_charsets.size(); }
+
+    /**
+     * @brief Get the charset of @a position.
+     */
+    std::string_view get_charset(size_t position) const
+    {
+        return m_charsets[m_position_charsets[position]];
+    }
+
+    /**
+     * @brief Get the distinct charsets.
+     */
+    const std::vector<std::string> &get_charsets() const { return m_charsets; }
+
+    /**
+     * @brief Get the index of the charset of @a position in @a get_charsets().
+     */
+    size_t get_charset_index(size_t position) const { return m_position_charsets[position]; }
+
+  private:
+    Mask() = default;
+
+    /**
+     * @brief Add a position with @a charset, which is added to the charsets if it is new.
+     */
+    void _add_position(const std::string &charset);
+
+    std::vector<std::string> m_charsets;
+    std::vector<uint8_t> m_position_charsets;
+};
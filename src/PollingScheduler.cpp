@@ -1,24 +1,39 @@
 #include "PollingScheduler.h"
 
+#include <algorithm>
+
 uint32_t PollingScheduler::schedule_task(
     std::string_view name, ScheduledTask function, std::chrono::milliseconds time_cycle)
 {
     auto id = m_scheduled_tasks.size();
     m_scheduled_tasks.emplace_back(name, function, time_cycle);
+
+    // A new task is due at once.
+    m_deadlines.emplace_back(Clock::now(), id);
+    std::push_heap(m_deadlines.begin(), m_deadlines.end(), std::greater<>());
+    m_next_deadline = m_deadlines.front().first;
     return id;
 }
 
-void PollingScheduler::poll()
+void PollingScheduler::_run_due_tasks()
 {
-    std::for_each(m_scheduled_tasks.begin(), m_scheduled_tasks.end(),
-        [&](sScheduledTaskParams &scheduled_params) {
-            if (std::chrono::steady_clock::now() < scheduled_params.time_reference) {
-                return;
-            }
+    // Move the due tasks out of the heap, to the end of the vector, so that each task runs at most
+    // once per poll, even with a zero time cycle.
+    const auto now   = Clock::now();
+    size_t due_count = 0;
+    while (due_count < m_deadlines.size() && m_deadlines.front().first <= now) {
+        std::pop_heap(m_deadlines.begin(), m_deadlines.end() - due_count, std::greater<>());
+        ++due_count;
+    }
+
+    // Put each due task back in the heap with its next deadline, and run it.
+    for (size_t i = m_deadlines.size() - due_count; i < m_deadlines.size(); ++i) {
+        const auto id        = m_deadlines[i].second;
+        m_deadlines[i].first = now + m_scheduled_tasks[id].time_cycle;
+        std::push_heap(m_deadlines.begin(), m_deadlines.begin() + i + 1, std::greater<>());
 
-            // std::cout << "Run task " << scheduled_params.task_name << std::endl;
-            scheduled_params.time_reference =
-                std::chrono::steady_clock::now() + scheduled_params.time_cycle;
-            scheduled_params.task();
-        });
+        // std::cout << "Run task " << m_scheduled_tasks[id].task_name << std::endl;
+        m_scheduled_tasks[id].task();
+    }
+    m_next_deadline = m_deadlines.empty() ? Clock::time_point::max() : m_deadlines.front().first;
 }
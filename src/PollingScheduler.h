@@ -1,9 +1,13 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
+#include <ctime>
 #include <functional>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 /**
  * @brief The PollingScheduler allows calling a function (task) periodically at certain time cycles.
@@ -17,6 +21,11 @@
  * faster than receiving events from from the Kernel especially in low frequency periods which will
  * use the branching mechanism of the CPU better.
  *
+ * The deadlines of the tasks are kept in a min-heap, and the earliest one is cached, so polling
+ * costs a single read of a coarse clock (see @a Clock) and a single comparison, whatever the number
+ * of tasks, until a task is due. It is meant to be polled between batches of work, e.g. once per
+ * batch of hashes, not once per hash.
+ *
  * @example
  *
  * PollingScheduler ps;
@@ -33,12 +42,43 @@ using ScheduledTask = std::function<void()>;
 
 class PollingScheduler {
   public:
+    /**
+     * @brief The clock of the deadlines, a steady clock which is cheap to read. On Linux, the
+     * coarse monotonic clock, which is read from memory without a syscall nor a cycle counter, at
+     * the resolution of the kernel tick (a few milliseconds), which is enough for periodic tasks.
+     */
+    struct Clock {
+        using duration                  = std::chrono::nanoseconds;
+        using rep                       = duration::rep;
+        using period                    = duration::period;
+        using time_point                = std::chrono::time_point<Clock>;
+        static constexpr bool is_steady = true;
+
+        static time_point now() noexcept
+        {
+#ifdef CLOCK_MONOTONIC_COARSE
+            timespec time;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+            return time_point(std::chrono::seconds(time.tv_sec) + duration(time.tv_nsec));
+#else
+            return time_point(std::chrono::duration_cast<duration>(
+                std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+        }
+    };
+
     /**
      * @brief Poll for timeout in all of the scheduled tasks. If there is a timout that task
      * function will be called.
      *
      */
-    void poll();
+    void poll()
+    {
+        if (Clock::now() < m_next_deadline) {
+            return;
+        }
+        _run_due_tasks();
+    }
 
     /**
      * @brief Schedule a task.
@@ -57,15 +97,32 @@ class PollingScheduler {
         sScheduledTaskParams(
             std::string_view name, ScheduledTask task_, std::chrono::milliseconds time_cycle_) :
             task_name(name),
-            task(task_), time_cycle(time_cycle_), time_reference(std::chrono::steady_clock::now())
+            task(task_), time_cycle(time_cycle_)
         {
         }
 
         std::string task_name;
         ScheduledTask task;
         std::chrono::milliseconds time_cycle;
-        std::chrono::steady_clock::time_point time_reference;
     };
 
+    /**
+     * @brief Run the tasks whose deadline has passed, and set their next deadline.
+     */
+    void _run_due_tasks();
+
+    /**
+     * @brief The scheduled tasks, indexed by their ID.
+     */
     std::vector<sScheduledTaskParams> m_scheduled_tasks;
+
+    /**
+     * @brief Min-heap of the next deadline of each task, with the task ID.
+     */
+    std::vector<std::pair<Clock::time_point, uint32_t>> m_deadlines;
+
+    /**
+     * @brief The earliest deadline of @a m_deadlines, the maximal time point if there is no task.
+     */
+    Clock::time_point m_next_deadline = Clock::time_point::max();
 };
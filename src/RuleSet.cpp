@@ -0,0 +1,414 @@
+#include "RuleSet.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief Get the position of the rule operand @a character, 0-9 then A-Z for 10-35.
+ */
+std::optional<uint8_t> get_position(char character)
+{
+    if (character >= '0' && character <= '9') {
+        return character - '0';
+    }
+    if (character >= 'A' && character <= 'Z') {
+        return character - 'A' + 10;
+    }
+    return std::nullopt;
+}
+
+// The case conversions don't branch, so the loops over the words buffers are vectorized.
+char to_lowercase(char character)
+{
+    return character + (static_cast<uint8_t>(character - 'A') < 26 ? 'a' - 'A' : 0);
+}
+
+char to_uppercase(char character)
+{
+    return character - (static_cast<uint8_t>(character - 'a') < 26 ? 'a' - 'A' : 0);
+}
+
+char toggle_case(char character)
+{
+    return character ^ (static_cast<uint8_t>((character | 0x20) - 'a') < 26 ? 0x20 : 0);
+}
+
+/**
+ * @brief Size of the chunks of the words buffers which the instructions run over, a SIMD vector.
+ */
+constexpr size_t chunk_size = 16;
+
+/**
+ * @brief Get the number of bytes at the beginning of the words buffers which hold all the words
+ * characters, in whole chunks.
+ */
+size_t get_width(const RuleSet::sWordBatch &batch)
+{
+    // A rejected size is larger than any word, the whole buffers are used then.
+    uint8_t max_size = 0;
+    for (size_t i = 0; i < batch.size; ++i) {
+        max_size = std::max(max_size, batch.sizes[i]);
+    }
+    return std::min((max_size + chunk_size - 1) / chunk_size * chunk_size, RuleSet::max_word_size);
+}
+
+} // namespace
+
+bool RuleSet::sWordBatch::add(std::string_view word)
+{
+    if (word.size() > max_word_size) {
+        return false;
+    }
+    std::memcpy(words[size].data(), word.data(), word.size());
+    sizes[size++] = static_cast<uint8_t>(word.size());
+    return true;
+}
+
+std::optional<RuleSet> RuleSet::parse(const std::vector<std::string> &rules)
+{
+    RuleSet rule_set;
+    for (const auto &rule : rules) {
+        if (!rule_set._compile(rule)) {
+            std::cerr << "Invalid rule \"" << rule << "\", skipped\n";
+        }
+    }
+
+    if (rule_set.size() == 0) {
+        std::cerr << "No valid rule\n";
+        return std::nullopt;
+    }
+    return rule_set;
+}
+
+std::optional<RuleSet> RuleSet::load(const std::string &path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open the rules file \"" << path << "\"\n";
+        return std::nullopt;
+    }
+
+    std::vector<std::string> rules;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.front() == '#') {
+            continue;
+        }
+        rules.push_back(std::move(line));
+    }
+
+    return parse(rules);
+}
+
+void RuleSet::apply(size_t rule_index, const sWordBatch &words, sWordBatch &candidates) const
+{
+    auto i         = m_rule_begins[rule_index];
+    const auto end = m_rule_begins[rule_index + 1];
+
+    candidates.size = words.size;
+    std::memcpy(candidates.sizes.data(), words.sizes.data(), words.size);
+
+    // A first instruction which converts the characters reads them from the words, otherwise they
+    // are copied first. Only the bytes which hold characters are copied, the rest of the buffers
+    // is never read.
+    if (i < end && _convert(m_instructions[i], words, candidates)) {
+        ++i;
+    } else {
+        const auto width = get_width(words);
+        for (size_t j = 0; j < words.size; ++j) {
+            for (size_t k = 0; k < width; k += chunk_size) {
+                std::memcpy(candidates.words[j].data() + k, words.words[j].data() + k, chunk_size);
+            }
+        }
+    }
+
+    for (; i < end; ++i) {
+        _execute(m_instructions[i], candidates);
+    }
+}
+
+bool RuleSet::_convert(const sInstruction &instruction, const sWordBatch &words,
+    sWordBatch &candidates)
+{
+    const auto operand_1 = instruction.operands[0];
+    const auto operand_2 = instruction.operands[1];
+
+    // The characters after the end of a word, up to the width, are converted too, it is cheaper
+    // than not to.
+    // The chunks are converted in a local buffer, as the words and the candidates may be the same.
+    // The first character of each word may be converted differently, after the others, in the
+    // candidate rather than in the chunk, which would be read back right after a single byte store.
+    auto convert_all = [&](auto &&convert, auto &&convert_first) {
+        const auto width = get_width(words);
+        const auto count = words.size;
+        for (size_t i = 0; i < count; ++i) {
+            for (size_t j = 0; j < width; j += chunk_size) {
+                char chunk[chunk_size];
+                std::memcpy(chunk, words.words[i].data() + j, chunk_size);
+                for (size_t k = 0; k < chunk_size; ++k) {
+                    chunk[k] = convert(chunk[k]);
+                }
+                std::memcpy(candidates.words[i].data() + j, chunk, chunk_size);
+            }
+            candidates.words[i][0] = convert_first(candidates.words[i][0]);
+        }
+        return true;
+    };
+    auto keep = [](char character) { return character; };
+
+    switch (instruction.opcode) {
+    case eOpcode::LOWERCASE:
+        return convert_all(to_lowercase, keep);
+    case eOpcode::UPPERCASE:
+        return convert_all(to_uppercase, keep);
+    case eOpcode::CAPITALIZE:
+        return convert_all(to_lowercase, to_uppercase);
+    case eOpcode::INVERT_CAPITALIZE:
+        return convert_all(to_uppercase, to_lowercase);
+    case eOpcode::TOGGLE_CASE:
+        return convert_all(toggle_case, keep);
+    case eOpcode::SUBSTITUTE: {
+        if (instruction.operands_size == 2) {
+            return convert_all(
+                [&](char character) {
+                    return character == char(operand_1) ? char(operand_2) : character;
+                },
+                keep);
+        }
+
+        // The unused pairs substitute 0 by 0, so all the pairs are applied, with no branch. The
+        // pairs are copied, the compiler can't tell they are not changed by the conversion.
+        const auto pairs = instruction.operands;
+        return convert_all(
+            [&](char character) {
+                for (size_t i = 0; i < pairs.size(); i += 2) {
+                    character = character == char(pairs[i]) ? char(pairs[i + 1]) : character;
+                }
+                return character;
+            },
+            keep);
+    }
+    default:
+        return false;
+    }
+}
+
+void RuleSet::_execute(const sInstruction &instruction, sWordBatch &candidates)
+{
+    if (_convert(instruction, candidates, candidates)) {
+        return;
+    }
+
+    const auto operands_size = instruction.operands_size;
+    const auto operand_1     = instruction.operands[0];
+
+    // The other instructions depend on the size of each word. They don't branch on it either: the
+    // characters after the end of a word are never read, so they are overwritten freely, and a
+    // rejected word is processed too, its size stays rejected. The sizes are updated in loops of
+    // their own, which are vectorized. The number of words is read once, as the compiler can't
+    // tell that the bytes stores don't change it.
+    constexpr auto rejected_size = sWordBatch::rejected_size;
+    auto &words                  = candidates.words;
+    auto &sizes                  = candidates.sizes;
+    const auto count             = candidates.size;
+
+    auto grow = [&]() {
+        for (size_t i = 0; i < count; ++i) {
+            sizes[i] = sizes[i] < max_word_size ? sizes[i] + 1 : rejected_size;
+        }
+    };
+    auto shrink = [&]() {
+        for (size_t i = 0; i < count; ++i) {
+            sizes[i] -= sizes[i] != 0 && sizes[i] != rejected_size;
+        }
+    };
+
+    switch (instruction.opcode) {
+    case eOpcode::TOGGLE_CASE_AT:
+        for (size_t i = 0; i < count; ++i) {
+            words[i][operand_1] = toggle_case(words[i][operand_1]);
+        }
+        return;
+    case eOpcode::APPEND: {
+        // The characters are written at once past the end of the word, along with zeros, in the
+        // bytes which are never read.
+        char appended[sizeof(uint64_t)] = {};
+        std::memcpy(appended, instruction.operands.data(), instruction.operands.size());
+        for (size_t i = 0; i < count; ++i) {
+            const auto word   = words[i].data();
+            const size_t size = sizes[i];
+            if (size + sizeof(appended) <= max_word_size) {
+                std::memcpy(word + size, appended, sizeof(appended));
+            } else {
+                // A word which gets full is rejected, whatever is written into it.
+                for (size_t j = size; j < std::min(size + operands_size, max_word_size); ++j) {
+                    word[j] = appended[j - size];
+                }
+            }
+        }
+        for (size_t i = 0; i < count; ++i) {
+            sizes[i] = sizes[i] + operands_size <= max_word_size ? sizes[i] + operands_size
+                                                                 : rejected_size;
+        }
+        return;
+    }
+    case eOpcode::PREPEND:
+        for (size_t i = 0; i < count; ++i) {
+            const auto word = words[i].data();
+            if (sizes[i] < chunk_size) {
+                char chunk[chunk_size];
+                std::memcpy(chunk, word, chunk_size);
+                std::memcpy(word + 1, chunk, chunk_size);
+            } else {
+                std::memmove(word + 1, word, max_word_size - 1);
+            }
+            word[0] = char(operand_1);
+        }
+        grow();
+        return;
+    case eOpcode::DUPLICATE:
+        // Append @a operand_1 copies of the word.
+        for (size_t i = 0; i < count; ++i) {
+            const auto word              = words[i].data();
+            const size_t size            = sizes[i];
+            const size_t duplicated_size = size * (operand_1 + 1);
+            char chunk[2 * chunk_size];
+            if (duplicated_size <= sizeof(chunk)) {
+                // Each copy overwrites the bytes after the previous one.
+                std::memcpy(chunk, word, sizeof(chunk));
+                for (size_t copy = 1; copy <= operand_1; ++copy) {
+                    std::memcpy(word + copy * size, chunk, sizeof(chunk));
+                }
+            } else if (duplicated_size <= max_word_size) {
+                for (size_t copy = 1; copy <= operand_1; ++copy) {
+                    std::memcpy(word + copy * size, word, size);
+                }
+            }
+            sizes[i] = duplicated_size <= max_word_size ? duplicated_size : rejected_size;
+        }
+        return;
+    case eOpcode::TRUNCATE:
+        for (size_t i = 0; i < count; ++i) {
+            sizes[i] = operand_1 < sizes[i] && sizes[i] != rejected_size ? operand_1 : sizes[i];
+        }
+        return;
+    case eOpcode::DELETE_FIRST:
+        for (size_t i = 0; i < count; ++i) {
+            const auto word = words[i].data();
+            if (sizes[i] <= chunk_size) {
+                char chunk[chunk_size];
+                std::memcpy(chunk, word + 1, chunk_size);
+                std::memcpy(word, chunk, chunk_size);
+            } else {
+                std::memmove(word, word + 1, max_word_size - 1);
+            }
+        }
+        shrink();
+        return;
+    case eOpcode::DELETE_LAST:
+        shrink();
+        return;
+    default:
+        return;
+    }
+}
+
+bool RuleSet::_compile(std::string_view rule)
+{
+    std::vector<sInstruction> instructions;
+
+    for (size_t i = 0; i < rule.size(); ++i) {
+        // Whether the function is followed by @a count operand characters.
+        auto has_operands = [&](size_t count) { return i + count < rule.size(); };
+
+        switch (rule[i]) {
+        case ' ':
+        case ':':
+            break;
+        case 'l':
+            instructions.push_back({eOpcode::LOWERCASE, 0, {}});
+            break;
+        case 'u':
+            instructions.push_back({eOpcode::UPPERCASE, 0, {}});
+            break;
+        case 'c':
+            instructions.push_back({eOpcode::CAPITALIZE, 0, {}});
+            break;
+        case 'C':
+            instructions.push_back({eOpcode::INVERT_CAPITALIZE, 0, {}});
+            break;
+        case 't':
+            instructions.push_back({eOpcode::TOGGLE_CASE, 0, {}});
+            break;
+        case 'd':
+            instructions.push_back({eOpcode::DUPLICATE, 1, {1}});
+            break;
+        case '[':
+            instructions.push_back({eOpcode::DELETE_FIRST, 0, {}});
+            break;
+        case ']':
+            instructions.push_back({eOpcode::DELETE_LAST, 0, {}});
+            break;
+        case '$':
+            if (!has_operands(1)) {
+                return false;
+            }
+            if (instructions.empty() || instructions.back().opcode != eOpcode::APPEND ||
+                instructions.back().operands_size == sInstruction::max_operands_size) {
+                instructions.push_back({eOpcode::APPEND, 0, {}});
+            }
+            instructions.back().operands[instructions.back().operands_size++] =
+                static_cast<uint8_t>(rule[i + 1]);
+            ++i;
+            break;
+        case '^':
+            if (!has_operands(1)) {
+                return false;
+            }
+            instructions.push_back({eOpcode::PREPEND, 1, {static_cast<uint8_t>(rule[i + 1])}});
+            ++i;
+            break;
+        case 's':
+            if (!has_operands(2)) {
+                return false;
+            }
+            if (instructions.empty() || instructions.back().opcode != eOpcode::SUBSTITUTE ||
+                instructions.back().operands_size == sInstruction::max_operands_size) {
+                instructions.push_back({eOpcode::SUBSTITUTE, 0, {}});
+            }
+            instructions.back().operands[instructions.back().operands_size++] =
+                static_cast<uint8_t>(rule[i + 1]);
+            instructions.back().operands[instructions.back().operands_size++] =
+                static_cast<uint8_t>(rule[i + 2]);
+            i += 2;
+            break;
+        case 'T':
+        case 'p':
+        case '\'': {
+            const auto position = has_operands(1) ? get_position(rule[i + 1]) : std::nullopt;
+            if (!position) {
+                return false;
+            }
+            const auto opcode = rule[i] == 'T'   ? eOpcode::TOGGLE_CASE_AT
+                                : rule[i] == 'p' ? eOpcode::DUPLICATE
+                                                 : eOpcode::TRUNCATE;
+            instructions.push_back({opcode, 1, {*position}});
+            ++i;
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    m_instructions.insert(m_instructions.end(), instructions.begin(), instructions.end());
+    m_rule_begins.push_back(static_cast<uint32_t>(m_instructions.size()));
+    return true;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The RuleSet mangles the words of a wordlist attack with hashcat compatible rules, e.g.
+ * "c $1" turns "password" into "Password1".
+ *
+ * @details The supported rule functions, where N is a position 0-9 or A-Z (10-35):
+ * - ':': nothing
+ * - 'l', 'u': lowercase, uppercase all the characters
+ * - 'c', 'C': capitalize, lowercase the first character and uppercase the rest
+ * - 't', 'TN': toggle the case of all the characters, of the character at N
+ * - '$X', '^X': append, prepend the character X
+ * - 'sXY': substitute each X by Y, e.g. "sa@ so0" for leet
+ * - 'd', 'pN': duplicate the word, append N copies of the word
+ * - '\'N', '[', ']': truncate the word to N characters, delete its first, its last character
+ * Spaces between functions are ignored.
+ *
+ * Each rule is compiled once into a few bytecode instructions. The rules are applied to a batch of
+ * words at once, instruction by instruction: each instruction is decoded once for the whole batch,
+ * and runs over the fixed size buffers of the words, with no branch on the characters, so the
+ * compiler vectorizes it. Nothing is allocated when the rules are applied.
+ *
+ * A word which would get longer than @a max_word_size is rejected, as in hashcat.
+ *
+ * @example
+ *
+ * auto rules = RuleSet::parse({":", "c $1", "sa@"});
+ * RuleSet::sWordBatch words, candidates;
+ * words.add("password");
+ * rules->apply(1, words, candidates);
+ * candidates.get(0); // "Password1"
+ */
+
+class RuleSet {
+  public:
+    /**
+     * @brief Maximal length of a word, the size of the buffer of a word.
+     */
+    static constexpr size_t max_word_size = 64;
+
+    /**
+     * @brief A batch of words in fixed size buffers, the input and the output of the rules.
+     */
+    struct sWordBatch {
+        static constexpr size_t capacity = 64;
+        static constexpr uint8_t rejected_size = 0xff;
+
+        /**
+         * @brief Add @a word at the end of the batch, which must not be full.
+         *
+         * @return true on success, false if @a word is longer than @a max_word_size.
+         */
+        bool add(std::string_view word);
+
+        /**
+         * @brief Get the word at @a index, empty if a rule rejected it.
+         */
+        std::string_view get(size_t index) const
+        {
+            if (sizes[index] == rejected_size) {
+                return {};
+            }
+            return {words[index].data(), sizes[index]};
+        }
+
+        alignas(64) std::array<std::array<char, max_word_size>, capacity> words = {};
+        std::array<uint8_t, capacity> sizes = {};
+        size_t size                          = 0;
+    };
+
+    /**
+     * @brief Compile @a rules. The invalid rules are reported and left out.
+     *
+     * @return std::optional containing the rule set, empty if none of the rules is valid.
+     */
+    static std::optional<RuleSet> parse(const std::vector<std::string> &rules);
+
+    /**
+     * @brief Compile the rules of the file at @a path, one per line. The empty lines and the lines
+     * which start with '#' are skipped, the invalid rules are reported and left out.
+     *
+     * @return std::optional containing the rule set, empty if the file cannot be read or none of
+     * its rules is valid.
+     */
+    static std::optional<RuleSet> load(const std::string &path);
+
+    /**
+     * @brief Get the number of rules.
+     */
+    size_t size() const { return m_rule_begins.size() - 1; }
+
+    /**
+     * @brief Apply the rule at @a rule_index to all the words of @a words.
+     *
+     * @param rule_index Index of the rule, less than the size.
+     * @param words The words, which are not changed.
+     * @param candidates Set to the mangled words, in the same order. A word rejected by the rule
+     * has the size @a sWordBatch::rejected_size.
+     */
+    void apply(size_t rule_index, const sWordBatch &words, sWordBatch &candidates) const;
+
+  private:
+    enum class eOpcode : uint8_t {
+        LOWERCASE,
+        UPPERCASE,
+        CAPITALIZE,
+        INVERT_CAPITALIZE,
+        TOGGLE_CASE,
+        TOGGLE_CASE_AT,
+        APPEND,
+        PREPEND,
+        SUBSTITUTE,
+        DUPLICATE,
+        TRUNCATE,
+        DELETE_FIRST,
+        DELETE_LAST,
+    };
+
+    /**
+     * @brief An instruction of the bytecode, an opcode and its operands, characters or a position.
+     * Consecutive appends are merged into a single APPEND of up to @a max_operands_size
+     * characters, and consecutive substitutions into a single SUBSTITUTE of up to 3 pairs.
+     */
+    struct sInstruction {
+        static constexpr size_t max_operands_size = 6;
+
+        eOpcode opcode;
+        uint8_t operands_size;
+        std::array<uint8_t, max_operands_size> operands;
+    };
+
+    RuleSet() = default;
+
+    /**
+     * @brief Compile @a rule and append its instructions.
+     *
+     * @return true on success, false if @a rule is invalid, in which case nothing is appended.
+     */
+    bool _compile(std::string_view rule);
+
+    /**
+     * @brief Run @a instruction on the words of @a words into @a candidates, which may be the same
+     * batch, if it converts the characters one by one, whatever the size of the words.
+     *
+     * @return true if @a instruction is such a conversion, false otherwise, in which case nothing
+     * is done.
+     */
+    static bool _convert(const sInstruction &instruction, const sWordBatch &words,
+        sWordBatch &candidates);
+
+    /**
+     * @brief Run @a instruction on the words of @a candidates.
+     */
+    static void _execute(const sInstruction &instruction, sWordBatch &candidates);
+
+    /**
+     * @brief The instructions of all the rules, and the index of the first instruction of each
+     * rule, followed by the number of instructions.
+     */
+    std::vector<sInstruction> m_instructions;
+    std::vector<uint32_t> m_rule_begins = {0};
+};
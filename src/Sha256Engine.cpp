@@ -0,0 +1,456 @@
+#include "Sha256Engine.h"
+
+#include "CpuFeatures.h"
+
+#include <cstring>
+#include <iostream>
+#include <sha256.h>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+// The SIMD kernels are written with GCC vector extensions, and passed by value between always
+// inlined helpers only, so the ABI notes about wide vector arguments are irrelevant.
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace {
+
+constexpr std::array<uint32_t, 8> initial_hash_values = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+    0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+constexpr std::array<uint32_t, 64> round_constants = {0x428a2f98, 0x71374491, 0xb5c0fbcf,
+    0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be,
+    0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6,
+    0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8,
+    0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
+    0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b, 0xc24b8b70,
+    0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116, 0x1e376c08, 0x2748774c,
+    0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814,
+    0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+inline uint32_t load_be32(const uint8_t *bytes)
+{
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return __builtin_bswap32(value);
+}
+
+inline void store_be32(uint8_t *bytes, uint32_t value)
+{
+    value = __builtin_bswap32(value);
+    std::memcpy(bytes, &value, sizeof(value));
+}
+
+inline uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+/**
+ * @brief The output of a kernel for each block: the full digest, or only the early reject word.
+ */
+template <bool EarlyReject>
+using KernelOutput = std::conditional_t<EarlyReject, uint32_t, Sha256Engine::Digest>;
+
+/**
+ * @brief The SHA-256 compression of single-block messages on @a Lanes lanes.
+ *
+ * @details @a Word is either uint32_t for the scalar kernel, or a GCC vector of @a Lanes uint32_t
+ * for the SIMD kernels. The same code is compiled for each instruction set by inlining it into
+ * functions with the matching target attribute.
+ * If @a EarlyReject is set, the compression stops after @a Sha256Engine::early_reject_rounds
+ * rounds, and only the 'a' word of the state is written.
+ */
+template <typename Word, size_t Lanes, bool EarlyReject>
+__attribute__((always_inline)) inline void compress_lanes(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs)
+{
+    auto rotr = [](Word x, int n) __attribute__((always_inline)) {
+        return (x >> n) | (x << (32 - n));
+    };
+
+    auto lane = [](Word &word, size_t index) __attribute__((always_inline))->uint32_t & {
+        if constexpr (Lanes == 1) {
+            return word;
+        } else {
+            return reinterpret_cast<uint32_t *>(&word)[index];
+        }
+    };
+
+    // Message schedule, kept as a 16 words circular buffer.
+    Word w[16];
+    for (size_t i = 0; i < 16; ++i) {
+        for (size_t l = 0; l < Lanes; ++l) {
+            lane(w[i], l) = load_be32(blocks[l].bytes + i * 4);
+        }
+    }
+
+    Word a = Word {} + initial_hash_values[0];
+    Word b = Word {} + initial_hash_values[1];
+    Word c = Word {} + initial_hash_values[2];
+    Word d = Word {} + initial_hash_values[3];
+    Word e = Word {} + initial_hash_values[4];
+    Word f = Word {} + initial_hash_values[5];
+    Word g = Word {} + initial_hash_values[6];
+    Word h = Word {} + initial_hash_values[7];
+
+    constexpr size_t rounds = EarlyReject ? Sha256Engine::early_reject_rounds : 64;
+
+    for (size_t i = 0; i < rounds; ++i) {
+        if (i >= 16) {
+            Word w15 = w[(i - 15) & 15];
+            Word w2  = w[(i - 2) & 15];
+            Word s0  = rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3);
+            Word s1  = rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10);
+            w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+        }
+
+        Word t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + (g ^ (e & (f ^ g))) +
+                  round_constants[i] + w[i & 15];
+        Word t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) | (c & (a | b)));
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    if constexpr (EarlyReject) {
+        for (size_t l = 0; l < Lanes; ++l) {
+            outputs[l] = lane(a, l);
+        }
+    } else {
+        Word state[8] = {a, b, c, d, e, f, g, h};
+        for (size_t i = 0; i < 8; ++i) {
+            state[i] += initial_hash_values[i];
+            for (size_t l = 0; l < Lanes; ++l) {
+                store_be32(outputs[l].data() + i * 4, lane(state[i], l));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Hash @a count blocks with a @a Lanes wide kernel. The tail which is smaller than the
+ * number of lanes is hashed on a padded copy of the blocks.
+ */
+template <typename Word, size_t Lanes, bool EarlyReject>
+__attribute__((always_inline)) inline void hash_blocks_lanes(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs, size_t count)
+{
+    size_t i = 0;
+    for (; i + Lanes <= count; i += Lanes) {
+        compress_lanes<Word, Lanes, EarlyReject>(blocks + i, outputs + i);
+    }
+
+    if (i == count) {
+        return;
+    }
+
+    Sha256Engine::sBlock tail_blocks[Lanes];
+    KernelOutput<EarlyReject> tail_outputs[Lanes];
+    const size_t tail_size = count - i;
+    for (size_t l = 0; l < Lanes; ++l) {
+        tail_blocks[l] = blocks[i + (l < tail_size ? l : 0)];
+    }
+    compress_lanes<Word, Lanes, EarlyReject>(tail_blocks, tail_outputs);
+    std::copy(tail_outputs, tail_outputs + tail_size, outputs + i);
+}
+
+template <bool EarlyReject>
+void hash_blocks_scalar(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs, size_t count)
+{
+    hash_blocks_lanes<uint32_t, 1, EarlyReject>(blocks, outputs, count);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+typedef uint32_t v8u32 __attribute__((vector_size(32)));
+typedef uint32_t v16u32 __attribute__((vector_size(64)));
+
+template <bool EarlyReject>
+__attribute__((target("avx2"))) void hash_blocks_avx2(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs, size_t count)
+{
+    hash_blocks_lanes<v8u32, 8, EarlyReject>(blocks, outputs, count);
+}
+
+template <bool EarlyReject>
+__attribute__((target("avx512f"))) void hash_blocks_avx512(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs, size_t count)
+{
+    hash_blocks_lanes<v16u32, 16, EarlyReject>(blocks, outputs, count);
+}
+
+/**
+ * @brief The SHA-256 compression of single-block messages with the SHA extensions.
+ *
+ * @details The sha256rnds2 instruction has a long latency, so @a Ways independent blocks are
+ * compressed in an interleaved manner to keep the SHA unit busy.
+ */
+template <size_t Ways, bool EarlyReject>
+__attribute__((target("sha,sse4.1"), always_inline)) inline void compress_shani(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs)
+{
+    // Swaps the bytes of each 32 bits word, from big endian to little endian and vice versa.
+    const __m128i byte_swap_mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The state is kept as two registers in the order the sha256rnds2 instruction expects: ABEF
+    // and CDGH, where A is the most significant word.
+    const __m128i abef_initial = _mm_set_epi32(initial_hash_values[0], initial_hash_values[1],
+        initial_hash_values[4], initial_hash_values[5]);
+    const __m128i cdgh_initial = _mm_set_epi32(initial_hash_values[2], initial_hash_values[3],
+        initial_hash_values[6], initial_hash_values[7]);
+
+    __m128i abef[Ways];
+    __m128i cdgh[Ways];
+    __m128i w[Ways][4];
+
+    for (size_t way = 0; way < Ways; ++way) {
+        abef[way] = abef_initial;
+        cdgh[way] = cdgh_initial;
+        for (size_t i = 0; i < 4; ++i) {
+            auto words = _mm_load_si128(reinterpret_cast<const __m128i *>(blocks[way].bytes) + i);
+            w[way][i]  = _mm_shuffle_epi8(words, byte_swap_mask);
+        }
+    }
+
+    // Each iteration performs 4 rounds, and extends the message schedule by 4 words.
+    for (size_t i = 0; i < 16; ++i) {
+        const auto k = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&round_constants[i * 4]));
+
+        for (size_t way = 0; way < Ways; ++way) {
+            auto msg  = _mm_add_epi32(w[way][i & 3], k);
+            cdgh[way] = _mm_sha256rnds2_epu32(cdgh[way], abef[way], msg);
+
+            // The two rounds above, swapped the roles of the registers, so 'cdgh' holds ABEF.
+            if constexpr (EarlyReject) {
+                static_assert(Sha256Engine::early_reject_rounds == 58);
+                if (i == 14) {
+                    outputs[way] = _mm_extract_epi32(cdgh[way], 3);
+                    continue;
+                }
+            }
+
+            msg       = _mm_shuffle_epi32(msg, 0x0e);
+            abef[way] = _mm_sha256rnds2_epu32(abef[way], cdgh[way], msg);
+
+            if (i < 12) {
+                auto &w0 = w[way][i & 3];
+                auto &w1 = w[way][(i + 1) & 3];
+                auto &w2 = w[way][(i + 2) & 3];
+                auto &w3 = w[way][(i + 3) & 3];
+                w0       = _mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4));
+                w0       = _mm_sha256msg2_epu32(w0, w3);
+            }
+        }
+
+        if (EarlyReject && i == 14) {
+            return;
+        }
+    }
+
+    if constexpr (!EarlyReject) {
+        for (size_t way = 0; way < Ways; ++way) {
+            abef[way] = _mm_add_epi32(abef[way], abef_initial);
+            cdgh[way] = _mm_add_epi32(cdgh[way], cdgh_initial);
+
+            // Reorder to ABCD and EFGH.
+            auto feba = _mm_shuffle_epi32(abef[way], 0x1b);
+            auto dchg = _mm_shuffle_epi32(cdgh[way], 0xb1);
+            auto dcba = _mm_blend_epi16(feba, dchg, 0xf0);
+            auto hgfe = _mm_alignr_epi8(dchg, feba, 8);
+
+            auto digest = reinterpret_cast<__m128i *>(outputs[way].data());
+            _mm_storeu_si128(digest, _mm_shuffle_epi8(dcba, byte_swap_mask));
+            _mm_storeu_si128(digest + 1, _mm_shuffle_epi8(hgfe, byte_swap_mask));
+        }
+    }
+}
+
+template <bool EarlyReject>
+__attribute__((target("sha,sse4.1"))) void hash_blocks_shani(
+    const Sha256Engine::sBlock *blocks, KernelOutput<EarlyReject> *outputs, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        compress_shani<4, EarlyReject>(blocks + i, outputs + i);
+    }
+    for (; i < count; ++i) {
+        compress_shani<1, EarlyReject>(blocks + i, outputs + i);
+    }
+}
+
+#endif
+
+/**
+ * @brief Verify @a kernel against the reference SHA-256 implementation, on messages of every
+ * length which fits in a single block.
+ */
+bool self_test(Sha256Engine::eKernel kernel)
+{
+    constexpr size_t max_message_size = sizeof(Sha256Engine::sBlock::bytes) - 9;
+    constexpr size_t blocks_count     = max_message_size + 1;
+
+    Sha256Engine::sBlock blocks[blocks_count];
+    Sha256Engine::Digest digests[blocks_count];
+
+    for (size_t size = 0; size < blocks_count; ++size) {
+        auto &bytes = blocks[size].bytes;
+        std::memset(bytes, 0, sizeof(bytes));
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = static_cast<uint8_t>(size * 31 + i * 7);
+        }
+        bytes[size] = 0x80;
+        store_be32(bytes + sizeof(bytes) - 4, size * 8);
+    }
+
+    uint32_t early_reject_words[blocks_count];
+
+    Sha256Engine engine(kernel);
+    engine.hash_blocks(blocks, digests, blocks_count);
+    engine.hash_blocks_early_reject(blocks, early_reject_words, blocks_count);
+
+    for (size_t size = 0; size < blocks_count; ++size) {
+        Sha256Engine::Digest reference_digest;
+        SHA256 sha256;
+        sha256.add(blocks[size].bytes, size);
+        sha256.getHash(reference_digest.data());
+
+        if (digests[size] != reference_digest ||
+            early_reject_words[size] != Sha256Engine::get_early_reject_word(reference_digest)) {
+            std::cerr << "SHA-256 " << Sha256Engine::get_kernel_name(kernel)
+                      << " kernel failed the self-test, message size " << size << "\n";
+            return false;
+        }
+    }
+
+    return true;
+}
+
+} // namespace
+
+Sha256Engine::Sha256Engine() : Sha256Engine(get_best_kernel()) {}
+
+Sha256Engine::Sha256Engine(eKernel kernel) :
+    m_kernel(kernel), m_hash_blocks(hash_blocks_scalar<false>),
+    m_hash_blocks_early_reject(hash_blocks_scalar<true>)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    switch (m_kernel) {
+    case eKernel::AVX2:
+        m_hash_blocks              = hash_blocks_avx2<false>;
+        m_hash_blocks_early_reject = hash_blocks_avx2<true>;
+        break;
+    case eKernel::AVX512:
+        m_hash_blocks              = hash_blocks_avx512<false>;
+        m_hash_blocks_early_reject = hash_blocks_avx512<true>;
+        break;
+    case eKernel::SHA_NI:
+        m_hash_blocks              = hash_blocks_shani<false>;
+        m_hash_blocks_early_reject = hash_blocks_shani<true>;
+        break;
+    case eKernel::SCALAR:
+        break;
+    }
+#else
+    m_kernel = eKernel::SCALAR;
+#endif
+}
+
+uint32_t Sha256Engine::get_early_reject_word(const Digest &digest)
+{
+    // The state after the last round, without the final addition of the initial hash values.
+    uint32_t state[8];
+    for (size_t i = 0; i < 8; ++i) {
+        state[i] = load_be32(digest.data() + i * 4) - initial_hash_values[i];
+    }
+
+    // 'a' values after 64 to 61 rounds are the a, b, c, d words of the final state, and 'e' values
+    // after 64 to 61 rounds are the e, f, g, h words.
+    // Each round i computes: a(i + 1) = t1 + t2(a(i), a(i - 1), a(i - 2)),
+    //                        e(i + 1) = a(i - 3) + t1.
+    // Therefore, t1 can be computed from known 'a' values, and then a(i - 3) = e(i + 1) - t1, going
+    // back one round at a time without knowing the message words.
+    uint32_t a[65];
+    uint32_t e[65];
+    for (size_t i = 0; i < 4; ++i) {
+        a[64 - i] = state[i];
+        e[64 - i] = state[4 + i];
+    }
+
+    for (size_t i = 64; i > early_reject_rounds + 3; --i) {
+        auto a1 = a[i - 1], a2 = a[i - 2], a3 = a[i - 3];
+        uint32_t t2 = (rotr(a1, 2) ^ rotr(a1, 13) ^ rotr(a1, 22)) + ((a1 & a2) | (a3 & (a1 | a2)));
+        uint32_t t1 = a[i] - t2;
+        a[i - 4]    = e[i] - t1;
+    }
+
+    return a[early_reject_rounds];
+}
+
+size_t Sha256Engine::get_lanes() const
+{
+    switch (m_kernel) {
+    case eKernel::AVX2:
+        return 8;
+    case eKernel::AVX512:
+        return 16;
+    case eKernel::SHA_NI:
+        return 4;
+    case eKernel::SCALAR:
+        break;
+    }
+    return 1;
+}
+
+bool Sha256Engine::is_kernel_supported(eKernel kernel)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    switch (kernel) {
+    case eKernel::AVX2:
+        return CpuFeatures::has_avx2();
+    case eKernel::AVX512:
+        return CpuFeatures::has_avx512f();
+    case eKernel::SHA_NI:
+        return CpuFeatures::has_sha();
+    case eKernel::SCALAR:
+        return true;
+    }
+#endif
+    return kernel == eKernel::SCALAR;
+}
+
+Sha256Engine::eKernel Sha256Engine::get_best_kernel()
+{
+    // Select once, the first time an engine is created, which is at the program startup.
+    static const eKernel best_kernel = []() {
+        for (auto kernel : {eKernel::AVX512, eKernel::SHA_NI, eKernel::AVX2}) {
+            if (is_kernel_supported(kernel) && self_test(kernel)) {
+                return kernel;
+            }
+        }
+        return eKernel::SCALAR;
+    }();
+
+    return best_kernel;
+}
+
+std::string_view Sha256Engine::get_kernel_name(eKernel kernel)
+{
+    switch (kernel) {
+    case eKernel::AVX2:
+        return "AVX2";
+    case eKernel::AVX512:
+        return "AVX-512";
+    case eKernel::SHA_NI:
+        return "SHA-NI";
+    case eKernel::SCALAR:
+        break;
+    }
+    return "Scalar";
+}
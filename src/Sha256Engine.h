@@ -0,0 +1,146 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @brief The Sha256Engine computes SHA-256 of many single-block messages at once.
+ *
+ * @details Password candidates are short, so after spicing and padding each one fits in a single
+ * 64 bytes SHA-256 block. Instead of hashing the candidates one by one, the engine hashes
+ * several of them in parallel, one candidate per SIMD lane (multi-buffer hashing):
+ * - AVX-512: 16 lanes.
+ * - AVX2: 8 lanes.
+ * - SHA-NI: the x86 SHA extensions, which compress a block with dedicated instructions. Four
+ *   blocks are interleaved to hide the instructions latency.
+ * - Scalar: 1 lane, used when no SIMD extension is available.
+ *
+ * The best kernel the CPU supports is selected at runtime, so the same binary runs on any x86-64
+ * machine. Before a kernel is selected, it must pass a self-test against the reference SHA-256
+ * implementation.
+ *
+ * Most candidates do not match any target, so the engine also offers an early reject mode. Given a
+ * target digest, the last SHA-256 rounds can be reversed to find the 'a' word of the state after
+ * @a early_reject_rounds rounds, without knowing the message (see @a get_early_reject_word()).
+ * Comparing this word lets the engine reject a candidate without computing the last rounds and the
+ * final addition. The rare candidates which pass must be fully hashed and verified.
+ *
+ * @example
+ *
+ * Sha256Engine engine;
+ * std::array<Sha256Engine::sBlock, 32> blocks;   // Padded single-block messages.
+ * std::array<Sha256Engine::Digest, 32> digests;
+ * engine.hash_blocks(blocks.data(), digests.data(), blocks.size());
+ */
+
+class Sha256Engine {
+  public:
+    /**
+     * @brief A single padded SHA-256 message block.
+     */
+    struct alignas(64) sBlock {
+        uint8_t bytes[64];
+    };
+
+    using Digest = std::array<uint8_t, 32>;
+
+    enum class eKernel {
+        SCALAR,
+        AVX2,
+        AVX512,
+        SHA_NI,
+    };
+
+    /**
+     * @brief Maximal number of lanes of all the kernels.
+     */
+    static constexpr size_t max_lanes = 16;
+
+    /**
+     * @brief Number of rounds computed in the early reject mode. Must be even, since the SHA-NI
+     * instructions perform two rounds at once.
+     */
+    static constexpr size_t early_reject_rounds = 58;
+
+    /**
+     * @brief Construct a new Sha256Engine object using the fastest kernel supported by the CPU.
+     */
+    Sha256Engine();
+
+    /**
+     * @brief Construct a new Sha256Engine object using the given kernel.
+     *
+     * @param kernel Kernel to use. Must be supported by the CPU, see @a is_kernel_supported().
+     */
+    explicit Sha256Engine(eKernel kernel);
+
+    /**
+     * @brief Hash @a count padded single-block messages.
+     *
+     * @param blocks Padded message blocks.
+     * @param digests Output digests, one per block.
+     * @param count Number of blocks to hash.
+     */
+    void hash_blocks(const sBlock *blocks, Digest *digests, size_t count) const
+    {
+        m_hash_blocks(blocks, digests, count);
+    }
+
+    /**
+     * @brief Compute only the first @a early_reject_rounds rounds of @a count padded
+     * single-block messages.
+     *
+     * @param blocks Padded message blocks.
+     * @param words Output 'a' words of the state after @a early_reject_rounds rounds, one per
+     * block. To be compared with @a get_early_reject_word() of the targets.
+     * @param count Number of blocks to process.
+     */
+    void hash_blocks_early_reject(const sBlock *blocks, uint32_t *words, size_t count) const
+    {
+        m_hash_blocks_early_reject(blocks, words, count);
+    }
+
+    /**
+     * @brief Reverse the last rounds of a single-block SHA-256 hash.
+     *
+     * @param digest Target digest.
+     * @return uint32_t The 'a' word of the state after @a early_reject_rounds rounds, of any
+     * single-block message which hashes to @a digest.
+     */
+    static uint32_t get_early_reject_word(const Digest &digest);
+
+    /**
+     * @brief Get the kernel used by the engine.
+     */
+    eKernel get_kernel() const { return m_kernel; }
+
+    /**
+     * @brief Get the number of candidates the engine kernel hashes in parallel.
+     */
+    size_t get_lanes() const;
+
+    /**
+     * @brief Returns true if @a kernel can run on this CPU.
+     */
+    static bool is_kernel_supported(eKernel kernel);
+
+    /**
+     * @brief Get the fastest kernel supported by the CPU, which passed the self-test.
+     */
+    static eKernel get_best_kernel();
+
+    /**
+     * @brief Get a printable name of @a kernel.
+     */
+    static std::string_view get_kernel_name(eKernel kernel);
+
+  private:
+    using HashBlocksFunction = void (*)(const sBlock *blocks, Digest *digests, size_t count);
+    using EarlyRejectFunction = void (*)(const sBlock *blocks, uint32_t *words, size_t count);
+
+    eKernel m_kernel;
+    HashBlocksFunction m_hash_blocks;
+    EarlyRejectFunction m_hash_blocks_early_reject;
+};
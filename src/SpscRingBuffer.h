@@ -0,0 +1,99 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief A bounded lock free queue between a single producer thread and a single consumer thread.
+ *
+ * @details The producer only writes the head index and the consumer only writes the tail index,
+ * each on its own cache line, so the two threads don't bounce a cache line on every entry. The
+ * producer keeps a copy of the tail, and reads the shared one only when its copy says the ring
+ * buffer is full. The consumer drains all the available entries at once: it reads the head once,
+ * and publishes its new tail once for the whole batch.
+ *
+ * @example
+ *
+ * SpscRingBuffer<sMessageSlot, 1024> ring_buffer;
+ *
+ * // Producer thread
+ * if (!ring_buffer.push(message)) {
+ *     // Full, try again later.
+ * }
+ *
+ * // Consumer thread
+ * ring_buffer.drain([](const sMessageSlot *messages, size_t count) { handle(messages, count); });
+ */
+
+template <typename T, size_t Capacity> class SpscRingBuffer {
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+  public:
+    /**
+     * @brief Add @a value at the end of the ring buffer. Producer thread only.
+     *
+     * @return true on success, false if the ring buffer is full, in which case @a value is not
+     * moved.
+     */
+    template <typename Value> bool push(Value &&value)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head - m_producer_tail == Capacity) {
+            m_producer_tail = m_tail.load(std::memory_order_acquire);
+            if (head - m_producer_tail == Capacity) {
+                return false;
+            }
+        }
+        m_slots[head & (Capacity - 1)] = std::forward<Value>(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Pass all the entries of the ring buffer to @a function, in order, and remove them.
+     * Consumer thread only. The entries pushed meanwhile are left to the next call.
+     *
+     * @details The entries are passed as contiguous segments, @a function is called with a pointer
+     * to the first entry and the number of entries of each segment: once, or twice if the entries
+     * wrap around the end of the ring buffer.
+     *
+     * @return size_t Number of entries passed to @a function.
+     */
+    template <typename Function> size_t drain(Function &&function)
+    {
+        const auto tail  = m_tail.load(std::memory_order_relaxed);
+        const auto head  = m_head.load(std::memory_order_acquire);
+        const auto count = head - tail;
+        if (count == 0) {
+            return 0;
+        }
+
+        const auto begin         = tail & (Capacity - 1);
+        const auto first_segment = std::min(count, Capacity - begin);
+        function(&m_slots[begin], first_segment);
+        if (first_segment < count) {
+            function(&m_slots[0], count - first_segment);
+        }
+        m_tail.store(head, std::memory_order_release);
+        return count;
+    }
+
+  private:
+    static constexpr size_t cache_line_size = 64;
+
+    /**
+     * @brief The producer's index and its copy of the consumer's index.
+     */
+    alignas(cache_line_size) std::atomic<size_t> m_head = 0;
+    size_t m_producer_tail                              = 0;
+
+    /**
+     * @brief The consumer's index.
+     */
+    alignas(cache_line_size) std::atomic<size_t> m_tail = 0;
+
+    alignas(cache_line_size) std::array<T, Capacity> m_slots = {};
+};
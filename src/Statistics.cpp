@@ -31,3 +31,20 @@ uint64_t Statistics::calculate_hash_rate_per_second(uint64_t hash_counter)
     // Calculate the final hash rate
     return hash_delta / (time_delta_ms / milliseconds_in_second);
 }
+
+double Statistics::calculate_false_positive_rate(
+    uint64_t checks_counter, uint64_t false_positives_counter)
+{
+    uint64_t checks_delta          = checks_counter - m_checks_counter_reference;
+    uint64_t false_positives_delta = false_positives_counter - m_false_positives_counter_reference;
+
+    // Update the counters references
+    m_checks_counter_reference          = checks_counter;
+    m_false_positives_counter_reference = false_positives_counter;
+
+    if (checks_delta == 0) {
+        return -1;
+    }
+
+    return static_cast<double>(false_positives_delta) / checks_delta;
+}
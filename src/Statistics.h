@@ -3,7 +3,8 @@
 #include <chrono>
 
 /**
- * @brief The Statistics class purpose is the calculate the hash rate in hashes/seconds.
+ * @brief The Statistics class purpose is the calculate the hash rate in hashes/seconds, and the
+ * false positive rate of the hash list prefilter.
  */
 
 class Statistics {
@@ -17,8 +18,20 @@ class Statistics {
      */
     uint64_t calculate_hash_rate_per_second(uint64_t hash_counter);
 
+    /**
+     * @brief Calculate the prefilter false positive rate since the previous call.
+     *
+     * @param checks_counter Total number of hashes tested by the prefilter.
+     * @param false_positives_counter Total number of hashes which passed the prefilter but are not
+     * in the hash list.
+     * @return Ratio of false positives to tested hashes, or a negative value if no hash was tested.
+     */
+    double calculate_false_positive_rate(uint64_t checks_counter, uint64_t false_positives_counter);
+
   private:
     // Reference to the state of the previous cycle
     uint64_t m_counter_reference;
     std::chrono::steady_clock::time_point m_time_reference;
+    uint64_t m_checks_counter_reference          = 0;
+    uint64_t m_false_positives_counter_reference = 0;
 };
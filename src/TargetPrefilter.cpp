@@ -0,0 +1,28 @@
+#include "TargetPrefilter.h"
+
+#include <algorithm>
+
+TargetPrefilter::TargetPrefilter(uint8_t bits_log2, const TargetSet &target_set)
+{
+    bits_log2 = std::clamp(bits_log2, min_bits_log2, max_bits_log2);
+
+    m_words.resize((1ull << bits_log2) / 64);
+    m_words_mask = m_words.size() - 1;
+
+    build(target_set);
+}
+
+void TargetPrefilter::build(const TargetSet &target_set)
+{
+    std::fill(m_words.begin(), m_words.end(), 0);
+
+    for (size_t i = 0; i < target_set.size(); ++i) {
+        if (target_set.is_cracked(i)) {
+            continue;
+        }
+
+        uint64_t word_index, bits;
+        _get_position(target_set.get_digest(i), word_index, bits);
+        m_words[word_index] |= bits;
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Sha256Engine.h"
+#include "TargetSet.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief The TargetPrefilter quickly rejects digests which are not in a TargetSet.
+ *
+ * @details Almost every candidate misses the hash list, so before the candidate digest is looked
+ * up in the TargetSet, it is tested against a small blocked Bloom filter:
+ * - The filter is a bitmap of 2^bits_log2 bits, at most 1 MiB, so it stays in the L2 cache
+ *   regardless of the size of the hash list.
+ * - Each hash sets @a bits_per_hash bits, all in the same 64 bits word, so a test reads a single
+ *   word.
+ * - The word and the bits are selected by bits of the digest itself, which are uniformly
+ *   distributed.
+ *
+ * A digest which fails the test is definitely not in the list. A digest which passes it may be a
+ * false positive, and must be looked up in the TargetSet. The false positive rate grows with the
+ * number of hashes per bit, so the filter helps most when the list is large.
+ *
+ * A Bloom filter can't delete hashes, so cracked hashes stay in the filter until it is rebuilt.
+ * They only cause false positives, which the TargetSet lookup rejects.
+ *
+ * @example
+ *
+ * TargetPrefilter prefilter(20, target_set);
+ * if (prefilter.may_contain(digest)) {
+ *     auto index = target_set.find(digest);
+ * }
+ */
+
+class TargetPrefilter {
+  public:
+    /**
+     * @brief The default size of the filter, 128 KiB.
+     */
+    static constexpr uint8_t default_bits_log2 = 20;
+
+    static constexpr uint8_t min_bits_log2 = 6;
+
+    /**
+     * @brief The maximal size of the filter, 1 MiB, a larger filter would miss the L2 cache on
+     * almost every test.
+     */
+    static constexpr uint8_t max_bits_log2 = 23;
+
+    /**
+     * @brief Construct a new TargetPrefilter object.
+     *
+     * @param bits_log2 Log2 of the filter size in bits, clamped to [min_bits_log2, max_bits_log2].
+     * @param target_set The hashes to add to the filter, cracked hashes are skipped.
+     */
+    TargetPrefilter(uint8_t bits_log2, const TargetSet &target_set);
+
+    /**
+     * @brief Rebuild the filter from the hashes of @a target_set which are not cracked yet.
+     */
+    void build(const TargetSet &target_set);
+
+    /**
+     * @brief Test if @a digest may be in the filter.
+     *
+     * @return false if @a digest is definitely not in the filter, otherwise true.
+     */
+    bool may_contain(const Sha256Engine::Digest &digest) const
+    {
+        uint64_t word_index, bits;
+        _get_position(digest, word_index, bits);
+        return (m_words[word_index] & bits) == bits;
+    }
+
+  private:
+    static constexpr size_t bits_per_hash = 3;
+
+    /**
+     * @brief Get the word and the bits in it of @a digest.
+     */
+    void _get_position(
+        const Sha256Engine::Digest &digest, uint64_t &word_index, uint64_t &bits) const
+    {
+        // Use the second half of the digest, independent of the bits which select the TargetSet
+        // bucket.
+        uint64_t word_hash, bits_hash;
+        std::memcpy(&word_hash, digest.data() + 16, sizeof(word_hash));
+        std::memcpy(&bits_hash, digest.data() + 24, sizeof(bits_hash));
+
+        word_index = word_hash & m_words_mask;
+
+        bits = 0;
+        for (size_t i = 0; i < bits_per_hash; ++i) {
+            bits |= 1ull << ((bits_hash >> (i * 6)) & 63);
+        }
+    }
+
+    std::vector<uint64_t> m_words;
+    uint64_t m_words_mask;
+};
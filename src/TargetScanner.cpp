@@ -0,0 +1,68 @@
+#include "TargetScanner.h"
+
+#include "CpuFeatures.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <immintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t keys_per_vector = 8;
+
+bool contains_scalar(const uint32_t *keys, size_t count, uint32_t key)
+{
+    bool found = false;
+    for (size_t i = 0; i < count; ++i) {
+        found |= keys[i] == key;
+    }
+    return found;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2"))) bool contains_avx2(
+    const uint32_t *keys, size_t count, uint32_t key)
+{
+    const __m256i broadcast_key = _mm256_set1_epi32(static_cast<int>(key));
+    __m256i matches             = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < count; i += keys_per_vector) {
+        const __m256i keys_vector = _mm256_load_si256(reinterpret_cast<const __m256i *>(keys + i));
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi32(keys_vector, broadcast_key));
+    }
+
+    return _mm256_movemask_epi8(matches) != 0;
+}
+#endif
+
+} // namespace
+
+TargetScanner::TargetScanner() : m_contains(contains_scalar)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    if (CpuFeatures::has_avx2()) {
+        m_contains = contains_avx2;
+    }
+#endif
+}
+
+bool TargetScanner::set_keys(const std::vector<uint32_t> &keys)
+{
+    if (keys.size() > max_keys) {
+        std::cerr << "Too many keys to scan: " << keys.size() << ", maximum is " << max_keys
+                  << "\n";
+        return false;
+    }
+
+    std::copy(keys.begin(), keys.end(), m_keys.begin());
+
+    // Pad the last vector with a key which is already in the set, so it can't add a match.
+    m_keys_count = (keys.size() + keys_per_vector - 1) / keys_per_vector * keys_per_vector;
+    std::fill(m_keys.begin() + keys.size(), m_keys.begin() + m_keys_count,
+        keys.empty() ? 0 : keys.front());
+
+    return true;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Sha256Engine.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * @brief The TargetScanner tests a 32 bits key against a small set of keys, by comparing it with
+ * all of them.
+ *
+ * @details When only a few hashes are left to crack (a contest-style list has about a hundred),
+ * a hash table or a binary search costs more than a plain scan. The keys are packed in an aligned
+ * array which fits in the L1 cache, and the scan compares 8 keys per AVX2 instruction and merges
+ * the results with no branches and no pointer chasing. Only the final result is tested.
+ *
+ * The key may be the first 32 bits of a digest (see @a get_digest_key()), or the early reject word
+ * of a digest (see Sha256Engine). A match only means the candidate may be a known hash, it must
+ * still be verified with a full compare.
+ *
+ * @example
+ *
+ * TargetScanner scanner;
+ * scanner.set_keys(keys);
+ * if (scanner.contains(TargetScanner::get_digest_key(digest))) {
+ *     auto index = target_set.find(digest);
+ * }
+ */
+
+class TargetScanner {
+  public:
+    /**
+     * @brief Maximal number of keys, above it a TargetSet lookup is faster.
+     */
+    static constexpr size_t max_keys = 256;
+
+    /**
+     * @brief Construct a new TargetScanner object with no keys. Uses AVX2 if the CPU supports it.
+     */
+    TargetScanner();
+
+    /**
+     * @brief Set the keys to scan.
+     *
+     * @param keys Keys, at most @a max_keys.
+     * @return true on success, otherwise false.
+     */
+    bool set_keys(const std::vector<uint32_t> &keys);
+
+    /**
+     * @brief Returns true if @a key is one of the keys.
+     */
+    bool contains(uint32_t key) const { return m_contains(m_keys.data(), m_keys_count, key); }
+
+    /**
+     * @brief Get the key of @a digest, its first 32 bits.
+     */
+    static uint32_t get_digest_key(const Sha256Engine::Digest &digest)
+    {
+        uint32_t key;
+        std::memcpy(&key, digest.data(), sizeof(key));
+        return key;
+    }
+
+  private:
+    using ContainsFunction = bool (*)(const uint32_t *keys, size_t count, uint32_t key);
+
+    ContainsFunction m_contains;
+
+    /**
+     * @brief The keys, padded to a multiple of 8 by repeating the first key.
+     */
+    alignas(32) std::array<uint32_t, max_keys> m_keys;
+    size_t m_keys_count = 0;
+};
@@ -0,0 +1,184 @@
+#include "TargetSet.h"
+
+#include <algorithm>
+#include <base64.h>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+std::vector<Sha256Engine::Digest> decode_hashes(const std::vector<std::string_view> &encoded_hashes)
+{
+    std::vector<Sha256Engine::Digest> digests;
+    digests.reserve(encoded_hashes.size());
+
+    for (auto hash_sv : encoded_hashes) {
+        std::string hash_str(hash_sv);
+
+        // The base64 library returns the decoded bytes encapsulated in a std::string.
+        auto b64_decoded_uint8s = base64_decode(hash_str);
+
+        Sha256Engine::Digest digest;
+        if (b64_decoded_uint8s.size() != digest.size()) {
+            std::cerr << "Hash " << std::quoted(hash_str) << " is not a SHA-256 hash, ignore\n";
+            continue;
+        }
+        std::copy(b64_decoded_uint8s.begin(), b64_decoded_uint8s.end(), digest.begin());
+        digests.push_back(digest);
+    }
+
+    return digests;
+}
+
+} // namespace
+
+TargetSet::TargetSet(const std::vector<std::string_view> &encoded_hashes) :
+    TargetSet(decode_hashes(encoded_hashes))
+{
+}
+
+TargetSet::TargetSet(std::vector<Sha256Engine::Digest> digests)
+{
+    // Remove the duplicated hashes, so each hash can be cracked only once.
+    std::sort(digests.begin(), digests.end());
+    digests.erase(std::unique(digests.begin(), digests.end()), digests.end());
+
+    m_digests.reserve(digests.size());
+    for (const auto &digest : digests) {
+        m_digests.push_back({digest});
+    }
+
+    // Keep the buckets at most 75% full, so the probe sequences are short and always end in an
+    // empty slot.
+    size_t buckets_count = 1;
+    while (buckets_count * sBucket::slots * 3 < digests.size() * 4) {
+        buckets_count *= 2;
+    }
+    m_buckets      = std::vector<sBucket>(buckets_count);
+    m_buckets_mask = buckets_count - 1;
+
+    for (size_t i = 0; i < m_digests.size(); ++i) {
+        _insert(i);
+    }
+
+    const size_t cracked_bits_words = (digests.size() + 63) / 64;
+    m_cracked_bits = std::make_unique<std::atomic<uint64_t>[]>(cracked_bits_words);
+    for (size_t i = 0; i < cracked_bits_words; ++i) {
+        m_cracked_bits[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+std::optional<size_t> TargetSet::find(const Sha256Engine::Digest &digest) const
+{
+    /**
+     * @details Linear probing on whole buckets. The search ends at the first bucket with an empty
+     * slot, since the insertion would have used it. Since the load of the table is low, almost
+     * all the searches end in the first bucket.
+     */
+
+    const auto fingerprint = _get_fingerprint(digest);
+
+    for (auto bucket_index = _get_bucket_index(digest);;
+         bucket_index      = (bucket_index + 1) & m_buckets_mask) {
+        const auto &bucket = m_buckets[bucket_index];
+
+        bool found_empty_slot = false;
+        for (size_t slot = 0; slot < sBucket::slots; ++slot) {
+            const auto slot_fingerprint = bucket.fingerprints[slot].load(std::memory_order_relaxed);
+            if (slot_fingerprint == fingerprint) {
+                const auto index = bucket.indices[slot];
+                if (m_digests[index].digest == digest && !is_cracked(index)) {
+                    return index;
+                }
+            }
+            found_empty_slot |= slot_fingerprint == empty_fingerprint;
+        }
+
+        if (found_empty_slot) {
+            return std::nullopt;
+        }
+    }
+}
+
+size_t TargetSet::find_batch(
+    const Sha256Engine::Digest *digests, size_t count, sMatch *matches) const
+{
+    for (size_t i = 0; i < count; ++i) {
+        prefetch(digests[i]);
+    }
+
+    size_t matches_count = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (auto index = find(digests[i])) {
+            matches[matches_count++] = {i, *index};
+        }
+    }
+
+    return matches_count;
+}
+
+std::string TargetSet::get_encoded_hash(size_t index) const
+{
+    const auto &digest = get_digest(index);
+    return base64_encode(digest.data(), digest.size());
+}
+
+bool TargetSet::mark_cracked(size_t index)
+{
+    const uint64_t bit = 1ull << (index % 64);
+    auto previous      = m_cracked_bits[index / 64].fetch_or(bit, std::memory_order_acq_rel);
+    if (previous & bit) {
+        return false;
+    }
+
+    _erase(index);
+
+    m_cracked_count.fetch_add(1, std::memory_order_release);
+    return true;
+}
+
+uint32_t TargetSet::_get_fingerprint(const Sha256Engine::Digest &digest)
+{
+    // Bits independent of the bucket index, mapped out of the reserved values.
+    uint32_t fingerprint;
+    std::memcpy(&fingerprint, digest.data() + sizeof(uint64_t), sizeof(fingerprint));
+    return std::max(fingerprint, tombstone_fingerprint + 1);
+}
+
+void TargetSet::_insert(size_t index)
+{
+    const auto &digest = m_digests[index].digest;
+
+    for (auto bucket_index = _get_bucket_index(digest);;
+         bucket_index      = (bucket_index + 1) & m_buckets_mask) {
+        auto &bucket = m_buckets[bucket_index];
+
+        for (size_t slot = 0; slot < sBucket::slots; ++slot) {
+            if (bucket.fingerprints[slot].load(std::memory_order_relaxed) == empty_fingerprint) {
+                bucket.fingerprints[slot].store(
+                    _get_fingerprint(digest), std::memory_order_relaxed);
+                bucket.indices[slot] = static_cast<uint32_t>(index);
+                return;
+            }
+        }
+    }
+}
+
+void TargetSet::_erase(size_t index)
+{
+    const auto &digest = m_digests[index].digest;
+
+    for (auto bucket_index = _get_bucket_index(digest);;
+         bucket_index      = (bucket_index + 1) & m_buckets_mask) {
+        auto &bucket = m_buckets[bucket_index];
+
+        for (size_t slot = 0; slot < sBucket::slots; ++slot) {
+            if (bucket.indices[slot] == index &&
+                bucket.fingerprints[slot].load(std::memory_order_relaxed) != empty_fingerprint) {
+                bucket.fingerprints[slot].store(tombstone_fingerprint, std::memory_order_relaxed);
+                return;
+            }
+        }
+    }
+}
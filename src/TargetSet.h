@@ -0,0 +1,204 @@
+#pragma once
+
+#include "Sha256Engine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * @brief The TargetSet holds the list of hashes to crack, shared by all the HashCrackerThreads.
+ *
+ * @details The list itself is immutable after construction, so any number of threads can search it
+ * without locking. The only mutable part is a bitmap of atomic "cracked" bits, parallel to the
+ * list:
+ * - A thread that finds a match marks the bit with an atomic read-modify-write. Only the first
+ *   thread to mark the bit is told it cracked the hash, so a discovery is never reported twice.
+ * - Every other thread stops matching the hash as soon as the bit is set, without any message.
+ * - A counter of cracked hashes lets the threads detect cheaply that the list has changed, to
+ *   rebuild data derived from the remaining hashes.
+ *
+ * Each hash is kept once, as a raw digest, for all the threads. The base64 encoded string is
+ * rebuilt from the digest only when it is needed for a report.
+ *
+ * The hashes are indexed by an open addressing hash table of 64 bytes buckets, one cache line
+ * each. A bucket holds the fingerprints of up to 8 hashes and their index in the list, so a
+ * candidate which matches no hash (the common case) costs a single cache line, and the full
+ * digest is compared only on a fingerprint match. A cracked hash is deleted from the table by
+ * replacing its fingerprint with a tombstone.
+ *
+ * @example
+ *
+ * auto target_set = std::make_shared<TargetSet>(hash_list);
+ *
+ * // Any thread
+ * auto index = target_set->find(digest);
+ * if (index && target_set->mark_cracked(*index)) {
+ *     std::cout << "cracked " << target_set->get_encoded_hash(*index) << "\n";
+ * }
+ */
+
+class TargetSet {
+  public:
+    /**
+     * @brief Construct a new TargetSet object.
+     *
+     * @param encoded_hashes List of base64 encoded SHA-256 hashes. Invalid and duplicated hashes
+     * are ignored.
+     */
+    explicit TargetSet(const std::vector<std::string_view> &encoded_hashes);
+
+    /**
+     * @brief Construct a new TargetSet object.
+     *
+     * @param digests List of raw SHA-256 digests. Duplicated digests are ignored.
+     */
+    explicit TargetSet(std::vector<Sha256Engine::Digest> digests);
+
+    /**
+     * @brief A match of a batch lookup.
+     */
+    struct sMatch {
+        size_t digest_index; // Index of the digest in the batch.
+        size_t target_index; // Index of the hash in the set.
+    };
+
+    /**
+     * @brief Get the number of hashes in the set, including the cracked ones.
+     */
+    size_t size() const { return m_digests.size(); }
+
+    /**
+     * @brief Find a hash which is not cracked yet.
+     *
+     * @param digest Raw digest to find.
+     * @return std::optional containing the index of the hash if found and not cracked, otherwise
+     * std::nullopt.
+     */
+    std::optional<size_t> find(const Sha256Engine::Digest &digest) const;
+
+    /**
+     * @brief Find a batch of digests, see @a find().
+     *
+     * @details The lookup of a single digest is a chain of dependent loads, which miss the cache
+     * when the set is large. The batch lookup first prefetches the first bucket of every digest,
+     * and only then searches them, so the memory latency of the lookups overlaps.
+     *
+     * @param digests Raw digests to find.
+     * @param count Number of digests.
+     * @param matches Output matches, must have room for @a count matches.
+     * @return size_t Number of matches.
+     */
+    size_t find_batch(const Sha256Engine::Digest *digests, size_t count, sMatch *matches) const;
+
+    /**
+     * @brief Prefetch the first bucket @a find() reads for @a digest. Allows a caller to overlap
+     * the memory latency of its own lookups.
+     */
+    void prefetch(const Sha256Engine::Digest &digest) const
+    {
+        __builtin_prefetch(&m_buckets[_get_bucket_index(digest)]);
+    }
+
+    /**
+     * @brief Get the digest of the hash at @a index.
+     */
+    const Sha256Engine::Digest &get_digest(size_t index) const { return m_digests[index].digest; }
+
+    /**
+     * @brief Get the base64 encoded hash at @a index.
+     */
+    std::string get_encoded_hash(size_t index) const;
+
+    /**
+     * @brief Returns true if the hash at @a index is cracked.
+     */
+    bool is_cracked(size_t index) const
+    {
+        return m_cracked_bits[index / 64].load(std::memory_order_relaxed) & (1ull << (index % 64));
+    }
+
+    /**
+     * @brief Mark the hash at @a index as cracked.
+     *
+     * @return true if this call marked the hash, false if it was already cracked.
+     */
+    bool mark_cracked(size_t index);
+
+    /**
+     * @brief Get the number of cracked hashes. The value changes every time a hash is cracked, so
+     * it can be used to detect changes of the remaining hashes.
+     */
+    size_t get_cracked_count() const { return m_cracked_count.load(std::memory_order_acquire); }
+
+  private:
+    /**
+     * @brief A bucket of the hash table, the size of a cache line.
+     *
+     * @details A fingerprint is a 32 bits word of the digest, different from the bits which
+     * select the bucket. The fingerprints are atomic since a tombstone may be written while other
+     * threads search the bucket.
+     */
+    struct alignas(64) sBucket {
+        static constexpr size_t slots = 8;
+        std::atomic<uint32_t> fingerprints[slots];
+        uint32_t indices[slots];
+    };
+    static_assert(sizeof(sBucket) == 64, "A bucket must fit in a single cache line");
+
+    /**
+     * @brief Reserved fingerprints values, the fingerprints of the digests are mapped to the
+     * other values.
+     */
+    static constexpr uint32_t empty_fingerprint     = 0;
+    static constexpr uint32_t tombstone_fingerprint = 1;
+
+    /**
+     * @brief Get the index of the first bucket to search for @a digest.
+     */
+    size_t _get_bucket_index(const Sha256Engine::Digest &digest) const
+    {
+        // The digests are uniformly distributed, so any of their bits can be used as hash.
+        uint64_t prefix;
+        std::memcpy(&prefix, digest.data(), sizeof(prefix));
+        return prefix & m_buckets_mask;
+    }
+
+    /**
+     * @brief Get the fingerprint of @a digest.
+     */
+    static uint32_t _get_fingerprint(const Sha256Engine::Digest &digest);
+
+    /**
+     * @brief Insert the hash at @a index to the hash table.
+     */
+    void _insert(size_t index);
+
+    /**
+     * @brief Replace the fingerprint of the hash at @a index in the hash table with a tombstone.
+     */
+    void _erase(size_t index);
+
+    /**
+     * @brief Digest aligned so it never crosses a cache line.
+     */
+    struct alignas(32) sAlignedDigest {
+        Sha256Engine::Digest digest;
+    };
+
+    std::vector<sAlignedDigest> m_digests;
+
+    /**
+     * @brief The hash table, its size is a power of 2.
+     */
+    std::vector<sBucket> m_buckets;
+    size_t m_buckets_mask = 0;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> m_cracked_bits;
+    std::atomic<size_t> m_cracked_count = 0;
+};
@@ -3,15 +3,15 @@
 #include <iostream>
 #include <string_view>
 
-Thread::Thread(
-    std::string_view thread_name, LoopFunction &&loop_func, ThreadInitFunction &&thread_init_func) :
+Thread::Thread(std::string_view thread_name, LoopFunction &&loop_func,
+    ThreadInitFunction &&thread_init_func, WakeUpFunction &&wake_up_func) :
     m_thread_name(thread_name),
-    m_loop_func(loop_func), m_thread_init_func(thread_init_func),
+    m_loop_func(loop_func), m_thread_init_func(thread_init_func), m_wake_up_func(wake_up_func),
     m_thread_state(eThreadState::NOT_STARTED)
 {
 }
 
-Thread::~Thread() { stop_thread(); }
+Thread::~Thread() { _set_stopped(); }
 
 void Thread::start_thread()
 {
@@ -22,6 +22,14 @@ void Thread::start_thread()
 }
 
 void Thread::stop_thread()
+{
+    _set_stopped();
+    if (m_wake_up_func) {
+        m_wake_up_func();
+    }
+}
+
+void Thread::_set_stopped()
 {
     std::cout << "Thread " << m_thread_name << " stopped"
               << "\n";
@@ -1,6 +1,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <string>
 #include <string_view>
@@ -10,6 +11,7 @@ class Thread {
   public:
     using LoopFunction       = std::function<void()>;
     using ThreadInitFunction = std::function<bool()>;
+    using WakeUpFunction     = std::function<void()>;
 
     /**
      * @brief Construct a new Thread object.
@@ -24,9 +26,11 @@ class Thread {
      * @param loop_func A function the thread will run in a loop.
      * @param thread_init_func An initialization function of the thread which will be run in the
      * thread context.
+     * @param wake_up_func A function which wakes up the thread when it is stopped, if the loop
+     * function may block, e.g. while it waits for messages.
      */
     Thread(std::string_view thread_name, LoopFunction &&loop_func,
-        ThreadInitFunction &&thread_init_func);
+        ThreadInitFunction &&thread_init_func, WakeUpFunction &&wake_up_func = nullptr);
 
     ~Thread();
 
@@ -43,6 +47,7 @@ class Thread {
 
     /**
      * @brief Stop the thread. Could be called from the thread itself or from the caller thread.
+     * A thread blocked in the loop function is woken up, see @a m_wake_up_func.
      */
     void stop_thread();
 
@@ -73,6 +78,11 @@ class Thread {
      */
     void _run();
 
+    /**
+     * @brief Move the thread to state eThreadState::STOPPED.
+     */
+    void _set_stopped();
+
     /**
      * @brief The thread name
      */
@@ -89,13 +99,19 @@ class Thread {
      */
     const ThreadInitFunction m_thread_init_func;
 
+    /**
+     * @brief Wakes up the thread when it is stopped, so it leaves the loop at once. Not called by
+     * the destructor, as the objects it uses may be destroyed already.
+     */
+    const WakeUpFunction m_wake_up_func;
+
     /**
      * @brief Internal state object.
      */
     std::thread m_thread;
 
     /**
-     * @brief Thread state.
+     * @brief Thread state, set by the caller thread and read by the thread itself.
      */
-    eThreadState m_thread_state;
+    std::atomic<eThreadState> m_thread_state;
 };
@@ -8,31 +8,131 @@
 
 MsgEndPoint::MsgEndPoint(SafeThreadQueues &io) : m_io(io) {}
 
-void MsgEndPoint::register_message_handler(MsgType msg_type, HandlerFunction handler_function)
+bool MsgEndPoint::_can_register_message_handler(MsgType msg_type) const
 {
-    auto found_iter = std::find_if(m_message_handlers.begin(), m_message_handlers.end(),
-        [&](const MsgHandler handler) { return msg_type == handler.first; });
+    if (msg_type >= max_message_types) {
+        std::cerr << "Message type " << msg_type << " is out of the handlers table, ignore\n";
+        return false;
+    }
 
-    if (found_iter != m_message_handlers.end()) {
+    if (m_message_handlers[msg_type].function) {
         std::cerr << "Handler for message type " << msg_type << " is already exist, ignore\n";
+        return false;
+    }
+
+    return true;
+}
+
+void MsgEndPoint::_report_missing_handler(MsgType msg_type)
+{
+    std::cerr << "Handler for message type " << msg_type << " not found\n";
+}
+
+void MsgEndPoint::handle_message_batch(const sMessageSlot *msgs, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        handle_message(msgs[i].get());
+    }
+}
+
+void MsgEndPoint::send_message(sMessageChannel &channel, const sMessageSlot &msg)
+{
+    channel.queue.push_back(msg);
+    channel.pending.store(true, std::memory_order_relaxed);
+}
+
+void MsgEndPoint::send_message_thread_safe(sMessageChannel &channel, const sMessageSlot &msg)
+{
+    if (m_io.transport == eMessageTransport::SPSC_RING_BUFFERS) {
+        if (!channel.overflowed.load(std::memory_order_acquire) && channel.ring_buffer.push(msg)) {
+            _set_pending_thread_safe(channel);
+            return;
+        }
+
+        // Rare case, the ring buffer is full, queue the messages until the consumer takes them.
+        channel.mutex.lock();
+        channel.queue.push_back(msg);
+        channel.overflowed.store(true, std::memory_order_release);
+        channel.mutex.unlock();
+        _set_pending_thread_safe(channel);
         return;
     }
 
-    m_message_handlers.emplace_back(MsgHandler {msg_type, handler_function});
+    channel.mutex.lock();
+    channel.queue.push_back(msg);
+    channel.mutex.unlock();
+    _set_pending_thread_safe(channel);
 }
 
-void MsgEndPoint::handle_message(std::unique_ptr<MsgBase> &&msg)
+void MsgEndPoint::_set_pending_thread_safe(sMessageChannel &channel)
 {
-    auto found_iter = std::find_if(m_message_handlers.begin(), m_message_handlers.end(),
-        [&](const MsgHandler handler) { return msg->message_type == handler.first; });
+    // If the flag was already set, the consumer sees it before it blocks.
+    if (channel.pending.exchange(true) || !channel.waiting.load()) {
+        return;
+    }
+
+    // The consumer holds the mutex from its check of the flag until it blocks, so it can't miss
+    // the notification.
+    channel.wait_mutex.lock();
+    channel.wait_mutex.unlock();
+    channel.wait_condition.notify_one();
+}
+
+void MsgEndPoint::wait_for_messages(sMessageChannel &channel, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(channel.wait_mutex);
+    channel.waiting.store(true);
+    channel.wait_condition.wait_for(lock, timeout, [&]() { return channel.pending.load(); });
+    channel.waiting.store(false);
+}
 
-    if (found_iter == m_message_handlers.end()) {
-        std::cerr << "Handler for message type " << msg->message_type << " not found\n";
+void MsgEndPoint::wake_up(sMessageChannel &channel) { _set_pending_thread_safe(channel); }
+
+void MsgEndPoint::handle_messages(sMessageChannel &channel)
+{
+    if (!channel.pending.load(std::memory_order_relaxed)) {
         return;
     }
+    channel.pending.store(false, std::memory_order_relaxed);
 
-    auto &handler_function = found_iter->second;
-    handler_function(std::move(msg));
+    // Handle the messages from the taken queue, in case a handler sends on the same channel.
+    channel.taken_queue.swap(channel.queue);
+    handle_message_batch(channel.taken_queue.data(), channel.taken_queue.size());
+    channel.taken_queue.clear();
+}
+
+void MsgEndPoint::handle_messages_thread_safe(sMessageChannel &channel)
+{
+    // Clear the flag before taking the messages, the messages sent meanwhile set it again.
+    if (!channel.pending.exchange(false, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    if (m_io.transport == eMessageTransport::SPSC_RING_BUFFERS) {
+        auto drain_ring_buffer = [&]() {
+            channel.ring_buffer.drain(
+                [&](const sMessageSlot *msgs, size_t count) { handle_message_batch(msgs, count); });
+        };
+        drain_ring_buffer();
+        if (!channel.overflowed.load(std::memory_order_acquire)) {
+            return;
+        }
+
+        // While the handlers ran, the sender may have filled the ring buffer before it queued a
+        // message. It pushes nothing more to the ring buffer until the queue is taken, so drain it
+        // again to handle these messages first.
+        drain_ring_buffer();
+    }
+
+    // Take all the queued messages at once, so the lock is not held by the handlers. With the ring
+    // buffers, the queued messages were sent after all the messages of the ring buffer, and the
+    // next messages go through the ring buffer again.
+    channel.mutex.lock();
+    channel.taken_queue.swap(channel.queue);
+    channel.overflowed.store(false, std::memory_order_release);
+    channel.mutex.unlock();
+    handle_message_batch(channel.taken_queue.data(), channel.taken_queue.size());
+    channel.taken_queue.clear();
 }
 
 /**************************************************************************************************/
@@ -41,97 +141,78 @@ void MsgEndPoint::handle_message(std::unique_ptr<MsgBase> &&msg)
 
 MsgInternalEndPoint::MsgInternalEndPoint(SafeThreadQueues &io) : MsgEndPoint(io) {}
 
-void MsgInternalEndPoint::send_message(std::unique_ptr<MsgBase> &&msg)
+void MsgInternalEndPoint::send_message(const sMessageSlot &msg)
 {
-    m_io.m_output_message_queue.emplace(std::move(msg));
+    MsgEndPoint::send_message(m_io.output, msg);
 }
 
-void MsgInternalEndPoint::send_message_thread_safe(std::unique_ptr<MsgBase> &&msg)
+void MsgInternalEndPoint::send_message_thread_safe(const sMessageSlot &msg)
 {
-    m_io.m_out_msg_mutex.lock();
-    m_io.m_output_message_queue.emplace(std::move(msg));
-    m_io.m_out_msg_mutex.unlock();
+    MsgEndPoint::send_message_thread_safe(m_io.output, msg);
 }
 
-void MsgInternalEndPoint::handle_messages()
+void MsgInternalEndPoint::handle_messages() { MsgEndPoint::handle_messages(m_io.input); }
+
+void MsgInternalEndPoint::handle_messages_thread_safe()
 {
-    while (true) {
-        if (m_io.m_input_message_queue.empty()) {
-            return;
-        }
-        auto msg = std::move(m_io.m_input_message_queue.front());
-        m_io.m_input_message_queue.pop();
-        handle_message(std::move(msg));
-        continue;
-    }
+    MsgEndPoint::handle_messages_thread_safe(m_io.input);
 }
 
-void MsgInternalEndPoint::handle_messages_thread_safe()
+bool MsgInternalEndPoint::has_pending_messages() const
 {
-    while (true) {
-        m_io.m_in_msg_mutex.lock();
-        if (m_io.m_input_message_queue.empty()) {
-            m_io.m_in_msg_mutex.unlock();
-            return;
-        }
-        auto msg = std::move(m_io.m_input_message_queue.front());
-        m_io.m_input_message_queue.pop();
-        m_io.m_in_msg_mutex.unlock();
-        handle_message(std::move(msg));
-    }
+    return MsgEndPoint::has_pending_messages(m_io.input);
+}
+
+void MsgInternalEndPoint::wait_for_messages(std::chrono::milliseconds timeout)
+{
+    MsgEndPoint::wait_for_messages(m_io.input, timeout);
 }
 
+void MsgInternalEndPoint::wake_up() { MsgEndPoint::wake_up(m_io.output); }
+
 /**************************************************************************************************/
 /* MsgExternalEndPoint                                                                            */
 /**************************************************************************************************/
 
 MsgExternalEndPoint::MsgExternalEndPoint(SafeThreadQueues &io) : MsgEndPoint(io) {}
 
-void MsgExternalEndPoint::send_message(std::unique_ptr<MsgBase> &&msg)
+void MsgExternalEndPoint::send_message(const sMessageSlot &msg)
 {
-    m_io.m_input_message_queue.emplace(std::move(msg));
+    MsgEndPoint::send_message(m_io.input, msg);
 }
 
-void MsgExternalEndPoint::send_message_thread_safe(std::unique_ptr<MsgBase> &&msg)
+void MsgExternalEndPoint::send_message_thread_safe(const sMessageSlot &msg)
 {
-    m_io.m_in_msg_mutex.lock();
-    m_io.m_input_message_queue.emplace(std::move(msg));
-    m_io.m_in_msg_mutex.unlock();
+    MsgEndPoint::send_message_thread_safe(m_io.input, msg);
 }
 
-void MsgExternalEndPoint::handle_messages()
+void MsgExternalEndPoint::handle_messages() { MsgEndPoint::handle_messages(m_io.output); }
+
+void MsgExternalEndPoint::handle_messages_thread_safe()
 {
-    while (true) {
-        if (m_io.m_output_message_queue.empty()) {
-            return;
-        }
-        auto msg = std::move(m_io.m_output_message_queue.front());
-        m_io.m_output_message_queue.pop();
-        handle_message(std::move(msg));
-        continue;
-    }
+    MsgEndPoint::handle_messages_thread_safe(m_io.output);
 }
 
-void MsgExternalEndPoint::handle_messages_thread_safe()
+bool MsgExternalEndPoint::has_pending_messages() const
 {
-    while (true) {
-        m_io.m_out_msg_mutex.lock();
-        if (m_io.m_output_message_queue.empty()) {
-            m_io.m_out_msg_mutex.unlock();
-            return;
-        }
-        auto msg = std::move(m_io.m_output_message_queue.front());
-        m_io.m_output_message_queue.pop();
-        m_io.m_out_msg_mutex.unlock();
-        handle_message(std::move(msg));
-    }
+    return MsgEndPoint::has_pending_messages(m_io.output);
+}
+
+void MsgExternalEndPoint::wait_for_messages(std::chrono::milliseconds timeout)
+{
+    MsgEndPoint::wait_for_messages(m_io.output, timeout);
 }
 
+void MsgExternalEndPoint::wake_up() { MsgEndPoint::wake_up(m_io.input); }
+
 /**************************************************************************************************/
 /* ThreadMessageIO                                                                                */
 /**************************************************************************************************/
 
-ThreadMessageIO::ThreadMessageIO() : m_internal_endpoint(m_io), m_external_endpoint(m_io) {}
+ThreadMessageIO::ThreadMessageIO(eMessageTransport transport) :
+    m_io(transport), m_internal_endpoint(m_io), m_external_endpoint(m_io)
+{
+}
 
 MsgInternalEndPoint &ThreadMessageIO::get_internal_endpoint() { return m_internal_endpoint; }
 MsgExternalEndPoint &ThreadMessageIO::get_external_endpoint() { return m_external_endpoint; }
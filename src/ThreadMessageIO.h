@@ -1,9 +1,16 @@
 #pragma once
 
-#include <functional>
-#include <memory>
+#include "SpscRingBuffer.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <type_traits>
+#include <vector>
 
 /**
  * @brief This file provides a simple one-to-many/many-to-one message-passing mechanism between
@@ -15,9 +22,9 @@
  * ThreadMessageIO object, while the external endpoint is used to send and receive messages on any
  * other thread.
  *
- * To send a message, call the @a send_message() method of the appropriate endpoint and pass a
- * unique_ptr to the message object. To receive messages, call the @a handle_messages() method of
- * the appropriate endpoint in a loop.
+ * To send a message, call the @a send_message() method of the appropriate endpoint and pass the
+ * message object. To receive messages, call the @a handle_messages() method of the appropriate
+ * endpoint in a loop.
  *
  * The EndPoint classes consist of two versions of each function: one that is thread-safe and blocks
  * until it acquires the lock on the input or output buffers, and releases the lock when the action
@@ -28,6 +35,26 @@
  * caters to both cases, or a function that is always thread-safe. Both of these scenarios would
  * have worse performance than having two separate functions with dedicated implementations.
  *
+ * The thread-safe functions move the messages through one of two transports, see
+ * @a eMessageTransport: a queue guarded by a mutex in each direction, or a lock free single
+ * producer, single consumer ring buffer in each direction. The ring buffers fit the common case of
+ * one thread on each side of the ThreadMessageIO: sending a message costs no lock, and the
+ * messages are drained in batches. The functions which are not thread-safe always use the queues.
+ *
+ * The messages are plain data, of a fixed maximal size, and are copied into the slots of the
+ * queues and ring buffers (see sMessageSlot). Once the queues have grown to the largest burst of
+ * messages, sending and handling a message allocates nothing.
+ *
+ * The handlers are kept in a table indexed by the message type, so the message types must be
+ * small integers, less than @a MsgEndPoint::max_message_types. A handler is any small, trivially
+ * copyable callable, e.g. a lambda which captures `this` or a few references, stored in the table
+ * itself and called through a plain function pointer.
+ *
+ * Each direction has a pending flag, set by the sends and cleared by the handling of the messages,
+ * so a busy thread checks for new messages with a single load (see @a has_pending_messages()),
+ * and an idle thread blocks until a message arrives (see @a wait_for_messages()), instead of
+ * polling the queues.
+ *
  * @example
  *
  * ### Message definition #########################################################################
@@ -52,9 +79,9 @@
  *  // Code ...
  *  MsgExternalEndPoint &get_external_endpoint() { return m_io.get_external_endpoint(); }
  *  private:
- *  void msg_1_handler(std::unique_ptr<MsgBase> &&message) {
- *    auto msg = static_cast<sMessage1 *>(message.get());
- *    std::cout << "arg1: " << msg->arg1 << ", arg2: " << msg->arg2 << "\n";
+ *  void msg_1_handler(const MsgBase &message) {
+ *    auto &msg = static_cast<const sMessage1 &>(message);
+ *    std::cout << "arg1: " << msg.arg1 << ", arg2: " << msg.arg2 << "\n";
  *  }
  *  ThreadMessageIO m_io;
  * };
@@ -63,16 +90,15 @@
  * // Register message
  * auto& internal_msg_endpoint = m_io.get_internal_endpoint();
  * internal_msg_endpoint.register_message_handler(eMessageType::MESSAGE_1,
- *  std::bind(&Owner::msg_1_handler, this, std::placeholders::_1));
+ *  [this](const MsgBase &message) { msg_1_handler(message); });
  *
  * ///// Handle messages /////
  * auto& internal_msg_endpoint = m_io.get_internal_endpoint();
  * internal_msg_endpoint.handle_messages();
  *
  * ///// Send a message /////
- * auto msg = std::make_unique<sSomeMessage>(1,2);
  * auto& internal_msg_endpoint = m_io.get_internal_endpoint();
- * internal_msg_endpoint.send_message(std::move(msg));
+ * internal_msg_endpoint.send_message(sMessage1(1, 2));
  *
  * ### Owner host code  ###########################################################################
  *
@@ -83,9 +109,9 @@
  * auto& external_msg_endpoint = m_io.get_external_endpoint();
  *
  * external_msg_endpoint.register_message_handler(eMessageType::MESSAGE_1,
- *  [&](std::unique_ptr<MsgBase> &&message) {
- *    auto msg = static_cast<sMessage1 *>(message.get());
- *    std::cout << "arg1: " << msg->arg1 << ", arg2: " << msg->arg2 << "\n";
+ *  [&](const MsgBase &message) {
+ *    auto &msg = static_cast<const sMessage1 &>(message);
+ *    std::cout << "arg1: " << msg.arg1 << ", arg2: " << msg.arg2 << "\n";
  *  });
  *
  * while (true) {
@@ -93,33 +119,106 @@
  *  external_msg_endpoint.handle_messages();
  *
  *  // Send messages
- * auto msg = std::make_unique<sSomeMessage>(1,2);
- *  external_msg_endpoint.send_message(std::move(msg));
+ *  external_msg_endpoint.send_message(sMessage1(1, 2));
  * }
  */
 
 /**
  * @brief The base message class for thread messages.
  *
- * Contains a unique message type identifier to identify the message.
+ * Contains a unique message type identifier to identify the message. The messages are trivially
+ * copyable, with no owning members such as std::string, so that they can be copied as bytes.
  */
 struct MsgBase {
     MsgBase(uint16_t msg_type) : message_type(msg_type) {}
-    virtual ~MsgBase() {}
     const uint16_t message_type;
 };
 
+/**
+ * @brief A copy of a message of any type derived from MsgBase, in a fixed size storage.
+ */
+struct sMessageSlot {
+    static constexpr size_t max_message_size = 120;
+
+    sMessageSlot() = default;
+
+    template <typename Message,
+        typename = std::enable_if_t<std::is_base_of_v<MsgBase, Message>>>
+    sMessageSlot(const Message &message)
+    {
+        static_assert(std::is_trivially_copyable_v<Message>, "Messages must be trivially copyable");
+        static_assert(sizeof(Message) <= max_message_size && alignof(Message) <= alignof(uint64_t),
+            "Message too large for a slot");
+        const MsgBase *base = new (bytes) Message(message);
+        base_offset         = reinterpret_cast<const unsigned char *>(base) - bytes;
+    }
+
+    /**
+     * @brief Get the message, to be cast to its type by its handler.
+     */
+    const MsgBase &get() const
+    {
+        return *std::launder(reinterpret_cast<const MsgBase *>(bytes + base_offset));
+    }
+
+    alignas(uint64_t) unsigned char bytes[max_message_size];
+    uint8_t base_offset = 0;
+};
+
+/**
+ * @brief How the thread-safe functions move the messages between the threads.
+ *
+ * MUTEX_QUEUES: Any number of threads may send, and a single thread handles the messages of each
+ * direction.
+ * SPSC_RING_BUFFERS: A single thread sends and a single thread handles the messages of each
+ * direction.
+ */
+enum class eMessageTransport : uint8_t {
+    MUTEX_QUEUES,
+    SPSC_RING_BUFFERS,
+};
+
+/**
+ * @brief The messages of one direction, in a queue guarded by a mutex, or in a ring buffer.
+ *
+ * The consumer swaps the queue with @a taken_queue, and handles the messages there, so both keep
+ * their capacity and queueing a message allocates nothing once they have grown.
+ *
+ * When the ring buffer is full, the next messages are queued instead and @a overflowed is set,
+ * until the consumer takes them all, so the sender never waits and the messages keep their order.
+ *
+ * @a pending is set after each message is queued, or to wake up the consumer, and cleared by the
+ * consumer before it takes the messages, so a message is never left unseen once the consumer
+ * found the flag cleared. The consumer sets @a waiting while it blocks on @a wait_condition, and
+ * only then does a sender notify it.
+ */
+struct sMessageChannel {
+    static constexpr size_t ring_buffer_capacity = 1024;
+
+    std::vector<sMessageSlot> queue;
+    std::vector<sMessageSlot> taken_queue;
+    std::mutex mutex;
+
+    SpscRingBuffer<sMessageSlot, ring_buffer_capacity> ring_buffer;
+    std::atomic<bool> overflowed = false;
+
+    std::atomic<bool> pending = false;
+    std::atomic<bool> waiting = false;
+    std::mutex wait_mutex;
+    std::condition_variable wait_condition;
+};
+
 /**
  * @brief Safe thread queues for message input and output.
  *
- * Contains a mutex for each queue to ensure thread safety if needed.
+ * Contains a mutex for each queue to ensure thread safety if needed, or a ring buffer.
  */
 struct SafeThreadQueues {
-    std::queue<std::unique_ptr<MsgBase>> m_input_message_queue;
-    std::mutex m_in_msg_mutex;
+    SafeThreadQueues(eMessageTransport transport_) : transport(transport_) {}
 
-    std::queue<std::unique_ptr<MsgBase>> m_output_message_queue;
-    std::mutex m_out_msg_mutex;
+    const eMessageTransport transport;
+    sMessageChannel input;
+    sMessageChannel output;
 };
 
 /**
@@ -137,41 +236,127 @@ class MsgEndPoint {
      */
     MsgEndPoint(SafeThreadQueues &io);
 
-    /**
-     * @brief A type alias for the message handler function.
-     */
-    using HandlerFunction = std::function<void(std::unique_ptr<MsgBase> &&msg)>;
-
     /**
      * @brief A type alias for the message type identifier.
      */
     using MsgType = uint16_t;
 
     /**
-     * @brief A type alias for the message handler pair.
+     * @brief Size of the handlers table, the message types must be less than it.
      */
-    using MsgHandler = std::pair<MsgType, HandlerFunction>;
+    static constexpr size_t max_message_types = 16;
 
     /**
      * @brief Register a message handler for a specific message type.
      *
-     * @param msg_type The unique message type identifier.
-     * @param handler_function The message handler function.
+     * @param msg_type The unique message type identifier, less than @a max_message_types.
+     * @param handler The message handler, called with a `const MsgBase &`. It is copied into the
+     * handlers table, so it must be trivially copyable and fit in @a sMsgHandler::max_size bytes.
      */
-    void register_message_handler(MsgType msg_type, HandlerFunction handler_function);
+    template <typename Handler> void register_message_handler(MsgType msg_type, Handler handler)
+    {
+        static_assert(std::is_trivially_copyable_v<Handler> &&
+                          sizeof(Handler) <= sMsgHandler::max_size &&
+                          alignof(Handler) <= alignof(void *),
+            "Message handlers must be small trivially copyable callables");
+        if (!_can_register_message_handler(msg_type)) {
+            return;
+        }
+
+        auto &entry = m_message_handlers[msg_type];
+        new (entry.handler) Handler(handler);
+        entry.function = [](const void *stored_handler, const MsgBase &msg) {
+            (*std::launder(static_cast<const Handler *>(stored_handler)))(msg);
+        };
+    }
 
   protected:
+    /**
+     * @brief A registered handler, a copy of the callable and the function which calls it.
+     */
+    struct sMsgHandler {
+        static constexpr size_t max_size = 32;
+
+        void (*function)(const void *handler, const MsgBase &msg) = nullptr;
+        alignas(void *) unsigned char handler[max_size];
+    };
+
     /**
      * @brief Handle a received message by calling its corresponding message handler function.
      *
-     * @param msg A unique pointer to the received message.
+     * @param msg The received message.
      */
-    void handle_message(std::unique_ptr<MsgBase> &&msg);
+    void handle_message(const MsgBase &msg)
+    {
+        if (msg.message_type >= max_message_types) {
+            _report_missing_handler(msg.message_type);
+            return;
+        }
+        const auto &entry = m_message_handlers[msg.message_type];
+        if (!entry.function) {
+            _report_missing_handler(msg.message_type);
+            return;
+        }
+        entry.function(entry.handler, msg);
+    }
+
+    /**
+     * @brief Handle the @a count messages of @a msgs in order, e.g. a drained segment of a ring
+     * buffer.
+     */
+    void handle_message_batch(const sMessageSlot *msgs, size_t count);
+
+    /**
+     * @brief Send @a msg on @a channel, or handle all the messages of @a channel, with the
+     * thread-safe functions or not.
+     */
+    void send_message(sMessageChannel &channel, const sMessageSlot &msg);
+    void send_message_thread_safe(sMessageChannel &channel, const sMessageSlot &msg);
+    void handle_messages(sMessageChannel &channel);
+    void handle_messages_thread_safe(sMessageChannel &channel);
+
+    /**
+     * @brief Whether messages were sent on @a channel since they were last handled. A hint only,
+     * the handling functions check it again.
+     */
+    static bool has_pending_messages(const sMessageChannel &channel)
+    {
+        return channel.pending.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Block until a message is sent on @a channel, or until @a timeout. Returns at once if
+     * messages are pending. With the thread-safe functions only, from the handling thread.
+     */
+    static void wait_for_messages(sMessageChannel &channel, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Wake up the consumer of @a channel, as a message would, with the thread-safe
+     * functions only.
+     */
+    static void wake_up(sMessageChannel &channel);
 
     SafeThreadQueues &m_io;
 
-    // Vector of registered message handlers.
-    std::vector<MsgHandler> m_message_handlers;
+    // Table of registered message handlers, indexed by message type.
+    std::array<sMsgHandler, max_message_types> m_message_handlers = {};
+
+  private:
+    /**
+     * @brief Check that a handler for @a msg_type can be registered, report why not otherwise.
+     */
+    bool _can_register_message_handler(MsgType msg_type) const;
+
+    /**
+     * @brief Report a message of @a msg_type which has no handler.
+     */
+    static void _report_missing_handler(MsgType msg_type);
+
+    /**
+     * @brief Set the pending flag of @a channel after a thread-safe send, and wake up its handling
+     * thread if it waits for messages.
+     */
+    static void _set_pending_thread_safe(sMessageChannel &channel);
 };
 
 /**
@@ -192,10 +377,10 @@ class MsgInternalEndPoint : public MsgEndPoint {
     /**
      * @brief Send a message on the internal endpoint.
      *
-     * @param msg A unique pointer to the message to be sent.
+     * @param msg The message to be sent, copied into a slot.
      */
-    void send_message(std::unique_ptr<MsgBase> &&msg);
-    void send_message_thread_safe(std::unique_ptr<MsgBase> &&msg);
+    void send_message(const sMessageSlot &msg);
+    void send_message_thread_safe(const sMessageSlot &msg);
 
     /**
      * @brief Processes all messages in the input message queue of the internal endpoint.
@@ -205,6 +390,19 @@ class MsgInternalEndPoint : public MsgEndPoint {
      */
     void handle_messages();
     void handle_messages_thread_safe();
+
+    /**
+     * @brief Whether incoming messages are pending, or block until they are, see the channel
+     * functions of MsgEndPoint.
+     */
+    bool has_pending_messages() const;
+    void wait_for_messages(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Wake up the thread which waits for the messages of this endpoint, as if a message was
+     * sent, e.g. to let it see that it is stopped.
+     */
+    void wake_up();
 };
 
 /**
@@ -224,10 +422,10 @@ class MsgExternalEndPoint : public MsgEndPoint {
     /**
      * @brief Send a message on the external endpoint.
      *
-     * @param msg A unique pointer to the message to be sent.
+     * @param msg The message to be sent, copied into a slot.
      */
-    void send_message(std::unique_ptr<MsgBase> &&msg);
-    void send_message_thread_safe(std::unique_ptr<MsgBase> &&msg);
+    void send_message(const sMessageSlot &msg);
+    void send_message_thread_safe(const sMessageSlot &msg);
 
     /**
      * @brief Processes all messages in the input message queue of the external endpoint.
@@ -237,6 +435,19 @@ class MsgExternalEndPoint : public MsgEndPoint {
      */
     void handle_messages();
     void handle_messages_thread_safe();
+
+    /**
+     * @brief Whether incoming messages are pending, or block until they are, see the channel
+     * functions of MsgEndPoint.
+     */
+    bool has_pending_messages() const;
+    void wait_for_messages(std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Wake up the thread which waits for the messages of this endpoint, as if a message was
+     * sent, e.g. to let it see that it is stopped.
+     */
+    void wake_up();
 };
 
 /**
@@ -245,9 +456,11 @@ class MsgExternalEndPoint : public MsgEndPoint {
 class ThreadMessageIO {
   public:
     /**
-     * @brief Default constructor for the ThreadMessageIO class.
+     * @brief Constructor for the ThreadMessageIO class.
+     *
+     * @param transport How the thread-safe functions move the messages.
      */
-    ThreadMessageIO();
+    ThreadMessageIO(eMessageTransport transport = eMessageTransport::MUTEX_QUEUES);
 
     /**
      * @brief Returns a reference to the internal endpoint of the message queue.
@@ -0,0 +1,92 @@
+#include "Wordlist.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+std::shared_ptr<Wordlist> Wordlist::open(const std::string &path)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open the wordlist \"" << path << "\"\n";
+        return nullptr;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+        std::cerr << "Failed to get the size of the wordlist \"" << path << "\"\n";
+        close(fd);
+        return nullptr;
+    }
+
+    // An empty file cannot be mapped, it is an empty wordlist.
+    const uint64_t size = file_stat.st_size;
+    void *data          = nullptr;
+    if (size) {
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    // The mapping keeps its own reference to the file.
+    close(fd);
+
+    if (data == MAP_FAILED) {
+        std::cerr << "Failed to map the wordlist \"" << path << "\"\n";
+        return nullptr;
+    }
+    if (data) {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+
+    return std::shared_ptr<Wordlist>(new Wordlist(static_cast<const char *>(data), size));
+}
+
+Wordlist::Wordlist(const char *data, uint64_t size) : m_data(data), m_size(size) {}
+
+Wordlist::~Wordlist()
+{
+    if (m_data) {
+        munmap(const_cast<char *>(m_data), m_size);
+    }
+}
+
+uint64_t Wordlist::get_word_begin(uint64_t offset) const
+{
+    if (offset == 0 || offset >= m_size) {
+        return std::min(offset, m_size);
+    }
+
+    // The line which holds the byte before the offset belongs to a previous range.
+    const auto line_end = static_cast<const char *>(
+        std::memchr(m_data + offset - 1, '\n', m_size - offset + 1));
+    return line_end ? line_end - m_data + 1 : m_size;
+}
+
+Wordlist::sCursor Wordlist::get_cursor(uint64_t offset) const
+{
+    sCursor cursor;
+    cursor.offset        = get_word_begin(offset);
+    cursor.window_offset = cursor.offset & ~(window_size - 1);
+    cursor.line_ends     = 0;
+    if (cursor.offset < m_size) {
+        // Only the line ends from the offset on.
+        const auto window_position = cursor.offset - cursor.window_offset;
+        cursor.line_ends =
+            _get_line_ends(cursor.window_offset) & (~uint64_t(0) << window_position);
+    }
+    return cursor;
+}
+
+void Wordlist::will_need(uint64_t offset, uint64_t size) const
+{
+    if (offset >= m_size) {
+        return;
+    }
+
+    // madvise works on whole pages.
+    static const uint64_t page_size = sysconf(_SC_PAGESIZE);
+    const uint64_t begin            = offset & ~(page_size - 1);
+    const uint64_t end              = std::min(offset + size, m_size);
+    madvise(const_cast<char *>(m_data) + begin, end - begin, MADV_WILLNEED);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#if defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+/**
+ * @brief The Wordlist maps a dictionary file, one word per line, into memory, so the words are read
+ * in place by all the HashCrackerThreads, with no copy and no allocation per word.
+ *
+ * @details The keyspace indices of a wordlist attack are the byte offsets in the file. A range of
+ * offsets [begin, end) holds the words which start in it, so any split of the file into byte
+ * ranges, at any offset, is aligned to the lines: the range that holds the first byte of a word
+ * hashes it, even if the word ends after the range.
+ *
+ * Lines end with "\n" or "\r\n", empty lines are skipped. The line ends are searched 64 bytes at a
+ * time with SIMD compares, and the words are walked through the resulting bitmask.
+ *
+ * The whole mapping is advised as sequential, and each reader advises the pages ahead of its
+ * position as needed (see @a will_need()), so the kernel reads the file ahead of the hashing even
+ * from a cold page cache.
+ *
+ * @example
+ *
+ * auto wordlist = Wordlist::open("rockyou.txt");
+ * for (auto cursor = wordlist->get_cursor(begin); cursor.offset < end;) {
+ *     auto word = wordlist->next_word(cursor);
+ * }
+ */
+
+class Wordlist {
+  public:
+    /**
+     * @brief Size of the pages ahead of a reader that it advises the kernel to read.
+     */
+    static constexpr uint64_t readahead_size = 8 << 20;
+
+    /**
+     * @brief Map the file at @a path.
+     *
+     * @return std::shared_ptr to the wordlist, null if the file cannot be mapped.
+     */
+    static std::shared_ptr<Wordlist> open(const std::string &path);
+
+    ~Wordlist();
+
+    Wordlist(const Wordlist &)            = delete;
+    Wordlist &operator=(const Wordlist &) = delete;
+
+    /**
+     * @brief Get the size of the file in bytes, the end of the keyspace indices.
+     */
+    uint64_t size() const { return m_size; }
+
+    /**
+     * @brief Get the content of the file.
+     */
+    std::string_view get_data() const { return {m_data, m_size}; }
+
+    /**
+     * @brief Get the offset of the first line which starts at or after @a offset, or the size if
+     * there is none.
+     */
+    uint64_t get_word_begin(uint64_t offset) const;
+
+    /**
+     * @brief Position of a reader in the wordlist: the beginning of its next line, and the line
+     * ends after it in its aligned window of @a window_size bytes.
+     */
+    struct sCursor {
+        uint64_t offset;
+        uint64_t window_offset;
+        uint64_t line_ends;
+    };
+
+    /**
+     * @brief Get a cursor at the first line which starts at or after @a offset.
+     */
+    sCursor get_cursor(uint64_t offset) const;
+
+    /**
+     * @brief Get the word of the line at @a cursor, without its line terminator, and move the
+     * cursor to the next line.
+     *
+     * @param cursor A cursor before the end of the wordlist.
+     * @return std::string_view The word in the mapping, empty for an empty line.
+     */
+    std::string_view next_word(sCursor &cursor) const
+    {
+        // The line ends are found a window at a time, so the words boundaries don't wait on each
+        // other. The last line may have no terminator.
+        uint64_t line_end = m_size;
+        while (!cursor.line_ends && cursor.window_offset + window_size < m_size) {
+            cursor.window_offset += window_size;
+            cursor.line_ends = _get_line_ends(cursor.window_offset);
+        }
+        if (cursor.line_ends) {
+            line_end = cursor.window_offset + __builtin_ctzll(cursor.line_ends);
+            cursor.line_ends &= cursor.line_ends - 1;
+        }
+
+        const auto line  = m_data + cursor.offset;
+        size_t word_size = line_end - cursor.offset;
+        if (word_size && line[word_size - 1] == '\r') {
+            --word_size;
+        }
+        cursor.offset = std::min(line_end + 1, m_size);
+        return {line, word_size};
+    }
+
+    /**
+     * @brief Advise the kernel to read the pages of [offset, offset + size) ahead of their use.
+     */
+    void will_need(uint64_t offset, uint64_t size) const;
+
+  private:
+    /**
+     * @brief Size of the windows in which the line ends are searched. The mapping is page aligned,
+     * so a window never crosses a page boundary.
+     */
+    static constexpr uint64_t window_size = 64;
+
+    Wordlist(const char *data, uint64_t size);
+
+    /**
+     * @brief Get the bitmask of the line ends in the window at @a window_offset, which is a
+     * multiple of @a window_size less than the size. The window may end after the end of the file,
+     * in the rest of its last page, which is filled with zeros.
+     */
+    uint64_t _get_line_ends(uint64_t window_offset) const
+    {
+        const auto window  = m_data + window_offset;
+        uint64_t line_ends = 0;
+#if defined(__SSE2__)
+        const auto new_line = _mm_set1_epi8('\n');
+        for (size_t i = 0; i < window_size; i += 16) {
+            const auto bytes = _mm_load_si128(reinterpret_cast<const __m128i *>(window + i));
+            const uint64_t mask =
+                static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, new_line)));
+            line_ends |= mask << i;
+        }
+#else
+        for (size_t i = 0; i < window_size; ++i) {
+            line_ends |= static_cast<uint64_t>(window[i] == '\n') << i;
+        }
+#endif
+        return line_ends;
+    }
+
+    const char *const m_data;
+    const uint64_t m_size;
+};
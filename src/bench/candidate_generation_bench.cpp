@@ -0,0 +1,165 @@
+/**
+ * @brief Benchmark of the password candidates generation, without hashing: the string based
+ * increment, the CandidateOdometer increment, and the HashGenerator batch fill which also writes
+ * the candidates into the SHA-256 message blocks. The CandidateOdometer and the batch fill are
+ * also measured with a mask of a charset per position. If a wordlist is given, the batch fill is
+ * also measured with its words, with its words followed by a mask in a hybrid attack, and with
+ * its words followed by its own words in a combinator attack.
+ *
+ * Usage: candidate_generation_bench [candidates_count] [wordlist]
+ * Default candidates count: 100000000.
+ */
+
+#include "../BaseOperationsUtils.h"
+#include "../CandidateOdometer.h"
+#include "../GlobalDefintions.h"
+#include "../HashGenerator.h"
+#include "../Mask.h"
+#include "../Wordlist.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+namespace {
+
+template <typename Function>
+void measure(std::string_view name, uint64_t candidates_count, Function &&function)
+{
+    const auto start    = std::chrono::steady_clock::now();
+    const auto checksum = function();
+    const auto elapsed  = std::chrono::steady_clock::now() - start;
+
+    std::cout << std::setw(30) << name << std::setw(12) << std::setprecision(3)
+              << std::chrono::duration<double, std::nano>(elapsed).count() / candidates_count
+              << " ns/candidate (checksum " << checksum << ")\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t candidates_count = 100000000;
+    if (argc > 1) {
+        candidates_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (candidates_count == 0) {
+        std::cerr << "Invalid candidates count\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout.setf(std::ios::fixed);
+
+    // The checksums keep the compiler from dropping the generated candidates.
+    measure("increment_base_x_integer", candidates_count, [&]() {
+        std::string candidate;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; ++i) {
+            BaseOperationsUtils::increment_base_x_integer(candidate, valid_chars);
+            checksum += candidate.back();
+        }
+        return checksum;
+    });
+
+    measure("CandidateOdometer", candidates_count, [&]() {
+        CandidateOdometer odometer(valid_chars);
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; ++i) {
+            checksum += odometer.increment();
+        }
+        return checksum + odometer.size();
+    });
+
+    measure("HashGenerator batch fill", candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, valid_chars);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            hash_generator.next_permutations(batch);
+            checksum += batch.blocks[batch.size - 1].bytes[salt.size()];
+        }
+        return checksum;
+    });
+
+    const auto mask = Mask::parse("?u?l?l?l?d?d?d?d");
+
+    measure("CandidateOdometer mask", candidates_count, [&]() {
+        CandidateOdometer odometer(*mask);
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; ++i) {
+            checksum += odometer.increment();
+        }
+        return checksum + odometer.size();
+    });
+
+    measure("HashGenerator mask fill", candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, *mask, mask->size(), mask->size());
+        hash_generator.set_next_index(0);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            hash_generator.next_permutations(batch);
+            checksum += batch.blocks[batch.size - 1].bytes[salt.size()];
+        }
+        return checksum;
+    });
+
+    if (argc <= 2) {
+        return EXIT_SUCCESS;
+    }
+    auto wordlist = Wordlist::open(argv[2]);
+    if (!wordlist) {
+        return EXIT_FAILURE;
+    }
+    const auto suffix_mask = Mask::parse("?d?d?d?d");
+
+    measure("HashGenerator wordlist fill", candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, wordlist);
+        hash_generator.set_next_index(0);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            if (!hash_generator.next_permutations(batch)) {
+                hash_generator.set_next_index(0);
+                continue;
+            }
+            checksum += batch.blocks[batch.size - 1].bytes[salt.size()];
+        }
+        return checksum;
+    });
+
+    measure("HashGenerator hybrid fill", candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, wordlist, *suffix_mask, suffix_mask->size(),
+            suffix_mask->size(), HashGenerator::eMaskPosition::APPEND);
+        hash_generator.set_next_index(0);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            if (!hash_generator.next_permutations(batch)) {
+                hash_generator.set_next_index(0);
+                continue;
+            }
+            checksum += batch.blocks[batch.size - 1].bytes[salt.size()];
+        }
+        return checksum;
+    });
+
+    measure("HashGenerator combinator fill", candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, wordlist, wordlist);
+        hash_generator.set_next_index(0);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            if (!hash_generator.next_permutations(batch)) {
+                hash_generator.set_next_index(0);
+                continue;
+            }
+            checksum += batch.blocks[batch.size - 1].bytes[salt.size()];
+        }
+        return checksum;
+    });
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+/**
+ * @brief Benchmark of the ThreadMessageIO message dispatch, the cost of finding and calling the
+ * handler of a message, one by one, by batch as the drained ring buffers, and with the queue of an
+ * endpoint. The messages cycle through 4 types, as the messages of a HashCrackerThread.
+ *
+ * Usage: dispatch_bench [messages_count]
+ * Default messages count: 10000000, each measure is repeated 5 times.
+ */
+
+#include "../ThreadMessageIO.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+constexpr uint16_t message_types_count = 4;
+
+/**
+ * @brief Number of messages queued before they are handled, as in a drained ring buffer.
+ */
+constexpr size_t batch_size = 256;
+
+/**
+ * @brief Number of times each measure is repeated, the fastest one is kept as the others are
+ * slowed down by the rest of the system.
+ */
+constexpr int repetitions = 5;
+
+struct sBenchMessage : MsgBase {
+    sBenchMessage(uint16_t message_type_, uint64_t value_) :
+        MsgBase(message_type_), value(value_)
+    {
+    }
+    uint64_t value;
+};
+
+/**
+ * @brief Exposes the dispatch of a single message, and of a batch of messages.
+ */
+class BenchEndPoint : public MsgEndPoint {
+  public:
+    using MsgEndPoint::handle_message;
+    using MsgEndPoint::handle_message_batch;
+    using MsgEndPoint::MsgEndPoint;
+};
+
+template <typename Function>
+double measure_ns_per_message(uint64_t messages_count, Function &&function)
+{
+    double min_ns = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        const auto start   = std::chrono::steady_clock::now();
+        function();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        min_ns          = i == 0 ? ns : std::min(min_ns, ns);
+    }
+    return min_ns / messages_count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t messages_count = 10000000;
+    if (argc > 1) {
+        messages_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (messages_count < batch_size) {
+        std::cerr << "Invalid messages count, at least " << batch_size << "\n";
+        return EXIT_FAILURE;
+    }
+    const auto batches_count = messages_count / batch_size;
+    messages_count           = batches_count * batch_size;
+
+    std::vector<sMessageSlot> messages;
+    for (size_t i = 0; i < batch_size; ++i) {
+        messages.emplace_back(sBenchMessage(i % message_types_count, i));
+    }
+
+    // The checksum keeps the compiler from dropping the work.
+    uint64_t checksum = 0;
+    auto register_handlers = [&](MsgEndPoint &endpoint) {
+        for (uint16_t message_type = 0; message_type < message_types_count; ++message_type) {
+            endpoint.register_message_handler(message_type, [&](const MsgBase &message) {
+                checksum += static_cast<const sBenchMessage &>(message).value;
+            });
+        }
+    };
+
+    SafeThreadQueues queues(eMessageTransport::MUTEX_QUEUES);
+    BenchEndPoint endpoint(queues);
+    register_handlers(endpoint);
+    const double dispatch_ns = measure_ns_per_message(messages_count, [&]() {
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            for (const auto &message : messages) {
+                endpoint.handle_message(message.get());
+            }
+        }
+    });
+
+    const double batch_dispatch_ns = measure_ns_per_message(messages_count, [&]() {
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            endpoint.handle_message_batch(messages.data(), messages.size());
+        }
+    });
+
+    ThreadMessageIO io;
+    register_handlers(io.get_external_endpoint());
+    const double queue_ns = measure_ns_per_message(messages_count, [&]() {
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            for (const auto &message : messages) {
+                io.get_internal_endpoint().send_message(message);
+            }
+            io.get_external_endpoint().handle_messages();
+        }
+    });
+
+    std::cout.setf(std::ios::fixed);
+    std::cout << message_types_count << " message types, batches of " << batch_size
+              << " messages, checksum " << checksum << "\n"
+              << std::setprecision(2) << std::setw(24) << "dispatch" << std::setw(10)
+              << dispatch_ns << " ns/message\n"
+              << std::setw(24) << "batch dispatch" << std::setw(10) << batch_dispatch_ns
+              << " ns/message\n"
+              << std::setw(24) << "send and handle" << std::setw(10) << queue_ns
+              << " ns/message\n";
+
+    return EXIT_SUCCESS;
+}
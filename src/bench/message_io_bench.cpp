@@ -0,0 +1,180 @@
+/**
+ * @brief Benchmark of the ThreadMessageIO transports, the mutex queues against the SPSC ring
+ * buffers. Each worker thread sends messages to the main thread through its own ThreadMessageIO,
+ * and the main thread handles the messages of all the workers in a polling loop, as the
+ * HashCrackerThreads report to the main thread. Measures the throughput, and the latency from the
+ * send to the handler, for 1 to 64 workers.
+ *
+ * A worker waits while @a max_in_flight of its messages are not handled yet, so the latency is
+ * the cost of the transport rather than the depth of an unbounded backlog.
+ *
+ * Then measures the latency from the send to the handler of a message to an idle thread, which
+ * blocks in @a wait_for_messages(), as an idle HashCrackerThread waiting for a task.
+ *
+ * Usage: message_io_bench [messages_count]
+ * Default messages count: 1000000, split between the workers.
+ */
+
+#include "../ThreadMessageIO.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr uint64_t max_in_flight = 256;
+
+struct sBenchMessage : MsgBase {
+    sBenchMessage(std::chrono::steady_clock::time_point send_time_) :
+        MsgBase(0), send_time(send_time_)
+    {
+    }
+    std::chrono::steady_clock::time_point send_time;
+};
+
+void run_benchmark(eMessageTransport transport, size_t workers_count, uint64_t messages_count)
+{
+    const uint64_t worker_messages_count = messages_count / workers_count;
+    messages_count                       = worker_messages_count * workers_count;
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve(messages_count);
+
+    std::vector<std::unique_ptr<ThreadMessageIO>> ios;
+    std::unique_ptr<std::atomic<uint64_t>[]> handled_counts(
+        new std::atomic<uint64_t>[workers_count]());
+    for (size_t i = 0; i < workers_count; ++i) {
+        ios.emplace_back(std::make_unique<ThreadMessageIO>(transport));
+        ios.back()->get_external_endpoint().register_message_handler(
+            0, [&, i](const MsgBase &message) {
+                const auto latency = std::chrono::steady_clock::now() -
+                                     static_cast<const sBenchMessage &>(message).send_time;
+                latencies.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+                handled_counts[i].fetch_add(1, std::memory_order_relaxed);
+            });
+    }
+
+    // The workers start together, once they are all created.
+    std::atomic<bool> start = false;
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < workers_count; ++i) {
+        workers.emplace_back([&, i]() {
+            while (!start.load()) {
+                std::this_thread::yield();
+            }
+            auto &endpoint = ios[i]->get_internal_endpoint();
+            for (uint64_t j = 0; j < worker_messages_count; ++j) {
+                while (j - handled_counts[i].load(std::memory_order_relaxed) >= max_in_flight) {
+                    std::this_thread::yield();
+                }
+                endpoint.send_message_thread_safe(sBenchMessage(std::chrono::steady_clock::now()));
+            }
+        });
+    }
+
+    const auto begin = std::chrono::steady_clock::now();
+    start.store(true);
+    while (latencies.size() < messages_count) {
+        const auto handled_count = latencies.size();
+        for (auto &io : ios) {
+            io->get_external_endpoint().handle_messages_thread_safe();
+        }
+
+        // Let the workers run when there are fewer cores than threads.
+        if (latencies.size() == handled_count) {
+            std::this_thread::yield();
+        }
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - begin;
+    for (auto &worker : workers) {
+        worker.join();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double ratio) { return latencies[size_t(ratio * (messages_count - 1))]; };
+
+    std::cout << std::setw(8)
+              << (transport == eMessageTransport::MUTEX_QUEUES ? "mutex" : "spsc") << std::setw(9)
+              << workers_count << std::setw(14) << std::setprecision(0)
+              << messages_count / std::chrono::duration<double>(elapsed).count() << std::setw(12)
+              << percentile(0.5) << std::setw(12) << percentile(0.99) << std::setw(12)
+              << percentile(0.999) << "\n";
+}
+
+void run_wakeup_benchmark(eMessageTransport transport)
+{
+    constexpr size_t messages_count = 1000;
+    std::vector<uint64_t> latencies;
+    latencies.reserve(messages_count);
+
+    ThreadMessageIO io(transport);
+    auto &internal_endpoint = io.get_internal_endpoint();
+    internal_endpoint.register_message_handler(0, [&](const MsgBase &message) {
+        const auto latency = std::chrono::steady_clock::now() -
+                             static_cast<const sBenchMessage &>(message).send_time;
+        latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+    });
+
+    std::atomic<size_t> handled_count = 0;
+    std::thread idle_thread([&]() {
+        while (latencies.size() < messages_count) {
+            internal_endpoint.wait_for_messages(std::chrono::seconds(1));
+            internal_endpoint.handle_messages_thread_safe();
+            handled_count.store(latencies.size());
+        }
+    });
+
+    // Send each message once the previous one is handled and the thread is idle again.
+    for (size_t i = 0; i < messages_count; ++i) {
+        while (handled_count.load() < i) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        io.get_external_endpoint().send_message_thread_safe(
+            sBenchMessage(std::chrono::steady_clock::now()));
+    }
+    idle_thread.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double ratio) { return latencies[size_t(ratio * (messages_count - 1))]; };
+    std::cout << std::setw(8) << (transport == eMessageTransport::MUTEX_QUEUES ? "mutex" : "spsc")
+              << std::setw(12) << percentile(0.5) << std::setw(12) << percentile(0.99)
+              << std::setw(12) << percentile(1) << "\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t messages_count = 1000000;
+    if (argc > 1) {
+        messages_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (messages_count < 64) {
+        std::cerr << "Invalid messages count, at least 64\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout.setf(std::ios::fixed);
+    std::cout << "Hardware threads: " << std::thread::hardware_concurrency() << "\n"
+              << "transport  workers    messages/s  p50 ns/msg  p99 ns/msg p99.9 ns/msg\n";
+    for (size_t workers_count = 1; workers_count <= 64; workers_count *= 2) {
+        run_benchmark(eMessageTransport::MUTEX_QUEUES, workers_count, messages_count);
+        run_benchmark(eMessageTransport::SPSC_RING_BUFFERS, workers_count, messages_count);
+    }
+
+    std::cout << "\nIdle thread wakeup\n"
+              << "transport  p50 ns/msg  p99 ns/msg  max ns/msg\n";
+    run_wakeup_benchmark(eMessageTransport::MUTEX_QUEUES);
+    run_wakeup_benchmark(eMessageTransport::SPSC_RING_BUFFERS);
+
+    return EXIT_SUCCESS;
+}
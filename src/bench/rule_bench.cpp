@@ -0,0 +1,176 @@
+/**
+ * @brief Benchmark of the RuleSet, the cost of mangling the words of a wordlist attack against the
+ * cost of hashing them with the Sha256Engine, and against the whole cost of a candidate of a
+ * wordlist attack with rules: the HashGenerator applies the rules, writes the candidates into the
+ * message blocks and hashes them with the early reject, as a HashCrackerThread does by default.
+ *
+ * Usage: rule_bench [candidates_count]
+ * Default candidates count: 10000000, each measure is repeated 5 times.
+ */
+
+#include "../GlobalDefintions.h"
+#include "../HashGenerator.h"
+#include "../RuleSet.h"
+#include "../Sha256Engine.h"
+#include "../Wordlist.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// A mix of common rules: case, appended digits and years, leet, duplication and truncation.
+const std::vector<std::string> rules = {":", "c", "u", "$1", "c $1", "$1 $2 $3", "^1",
+    "c $2 $0 $2 $3", "sa@ se3 so0", "c sa@ $!", "d", "'6", "] ]", "T0 T2", "t", "[ $0"};
+
+/**
+ * @brief Number of times each measure is repeated, the fastest one is kept as the others are
+ * slowed down by the rest of the system.
+ */
+constexpr int repetitions = 5;
+
+template <typename Function>
+double measure_ns_per_candidate(uint64_t candidates_count, Function &&function)
+{
+    double min_ns = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        const auto start    = std::chrono::steady_clock::now();
+        const auto checksum = function();
+        const auto elapsed  = std::chrono::steady_clock::now() - start;
+
+        // The checksum keeps the compiler from dropping the work.
+        if (checksum == 1) {
+            std::cout << "";
+        }
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        min_ns          = i == 0 ? ns : std::min(min_ns, ns);
+    }
+    return min_ns / candidates_count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t candidates_count = 10000000;
+    if (argc > 1) {
+        candidates_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (candidates_count == 0) {
+        std::cerr << "Invalid candidates count\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto rule_set = RuleSet::parse(rules);
+    if (!rule_set) {
+        return EXIT_FAILURE;
+    }
+
+    // A wordlist of lowercase words of 6 to 10 characters, and a window of its first words.
+    constexpr size_t wordlist_words_count = 1 << 16;
+    std::mt19937_64 generator(0);
+    RuleSet::sWordBatch words;
+    const auto wordlist_path = std::filesystem::temp_directory_path() / "rule_bench_wordlist.txt";
+    {
+        std::ofstream wordlist_file(wordlist_path, std::ios::binary);
+        for (size_t i = 0; i < wordlist_words_count; ++i) {
+            std::string word(6 + generator() % 5, 'a');
+            for (auto &character : word) {
+                character = static_cast<char>('a' + generator() % 26);
+            }
+            if (words.size < RuleSet::sWordBatch::capacity) {
+                words.add(word);
+            }
+            wordlist_file << word << "\n";
+        }
+    }
+    const auto wordlist = Wordlist::open(wordlist_path.string());
+    std::filesystem::remove(wordlist_path);
+    if (!wordlist) {
+        return EXIT_FAILURE;
+    }
+
+    const auto batches_count = (candidates_count + words.size - 1) / words.size;
+    candidates_count         = batches_count * words.size;
+
+    const double rules_ns = measure_ns_per_candidate(candidates_count, [&]() {
+        RuleSet::sWordBatch candidates;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            rule_set->apply(i % rule_set->size(), words, candidates);
+            checksum += candidates.sizes[i % candidates.size];
+        }
+        return checksum;
+    });
+
+    // Single block messages, as the HashGenerator writes them.
+    const Sha256Engine engine;
+    std::vector<Sha256Engine::sBlock> blocks(words.size);
+    std::vector<Sha256Engine::Digest> digests(words.size);
+    std::vector<uint32_t> early_reject_words(words.size);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        for (size_t j = 0; j < sizeof(blocks[i].bytes); ++j) {
+            blocks[i].bytes[j] = static_cast<uint8_t>(generator());
+        }
+    }
+
+    const double sha256_ns = measure_ns_per_candidate(candidates_count, [&]() {
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            engine.hash_blocks(blocks.data(), digests.data(), blocks.size());
+            checksum += digests[i % digests.size()][0];
+        }
+        return checksum;
+    });
+
+    const double early_reject_ns = measure_ns_per_candidate(candidates_count, [&]() {
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            engine.hash_blocks_early_reject(
+                blocks.data(), early_reject_words.data(), blocks.size());
+            checksum += early_reject_words[i % early_reject_words.size()];
+        }
+        return checksum;
+    });
+
+    const auto shared_rule_set   = std::make_shared<const RuleSet>(*rule_set);
+    const double rules_attack_ns = measure_ns_per_candidate(candidates_count, [&]() {
+        HashGenerator hash_generator(salt, pepper, wordlist, shared_rule_set);
+        hash_generator.set_next_index(0);
+        sHashBatch batch;
+        uint64_t checksum = 0;
+        for (uint64_t i = 0; i < candidates_count; i += batch.size) {
+            if (!hash_generator.next_early_reject_words(batch)) {
+                hash_generator.set_next_index(0);
+                continue;
+            }
+            checksum += batch.early_reject_words[batch.size - 1];
+        }
+        return checksum;
+    });
+
+    constexpr double percent = 100;
+    std::cout.setf(std::ios::fixed);
+    std::cout << "SHA-256 kernel: " << Sha256Engine::get_kernel_name(engine.get_kernel()) << "\n"
+              << rule_set->size() << " rules over " << words.size << " words windows\n"
+              << std::setprecision(3) << std::setw(24) << "rules" << std::setw(12) << rules_ns
+              << " ns/candidate\n"
+              << std::setw(24) << "SHA-256" << std::setw(12) << sha256_ns << " ns/candidate, rules "
+              << std::setprecision(1) << rules_ns / sha256_ns * percent << "%\n"
+              << std::setprecision(3) << std::setw(24) << "SHA-256 early reject" << std::setw(12)
+              << early_reject_ns << " ns/candidate, rules " << std::setprecision(1)
+              << rules_ns / early_reject_ns * percent << "%\n"
+              << std::setprecision(3) << std::setw(24) << "rules attack" << std::setw(12)
+              << rules_attack_ns << " ns/candidate, rules " << std::setprecision(1)
+              << rules_ns / rules_attack_ns * percent << "%\n";
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/**
+ * @brief Benchmark of the PollingScheduler, the cost of polling it between the batches of hashes
+ * of a HashCrackerThread, against the cost of hashing a batch with the Sha256Engine. The scheduled
+ * tasks are not due during the measure, as almost always between two batches.
+ *
+ * Usage: scheduler_bench [polls_count]
+ * Default polls count: 1000000, each measure is repeated 5 times.
+ */
+
+#include "../HashGenerator.h"
+#include "../PollingScheduler.h"
+#include "../Sha256Engine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Number of times each measure is repeated, the fastest one is kept as the others are
+ * slowed down by the rest of the system.
+ */
+constexpr int repetitions = 5;
+
+template <typename Function> double measure_ns(uint64_t count, Function &&function)
+{
+    double min_ns = 0;
+    for (int i = 0; i < repetitions; ++i) {
+        const auto start   = std::chrono::steady_clock::now();
+        function();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+
+        const double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+        min_ns          = i == 0 ? ns : std::min(min_ns, ns);
+    }
+    return min_ns / count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    uint64_t polls_count = 1000000;
+    if (argc > 1) {
+        polls_count = std::strtoull(argv[1], nullptr, 10);
+    }
+    if (polls_count == 0) {
+        std::cerr << "Invalid polls count\n";
+        return EXIT_FAILURE;
+    }
+
+    // Single block messages, as the HashGenerator writes them.
+    const Sha256Engine engine;
+    std::mt19937_64 generator(0);
+    std::vector<Sha256Engine::sBlock> blocks(sHashBatch::capacity);
+    std::vector<Sha256Engine::Digest> digests(blocks.size());
+    for (auto &block : blocks) {
+        for (auto &byte : block.bytes) {
+            byte = static_cast<uint8_t>(generator());
+        }
+    }
+    const uint64_t batches_count = std::max<uint64_t>(polls_count / 100, 1);
+    const double sha256_ns       = measure_ns(batches_count * blocks.size(), [&]() {
+        for (uint64_t i = 0; i < batches_count; ++i) {
+            engine.hash_blocks(blocks.data(), digests.data(), blocks.size());
+        }
+    });
+
+    constexpr double percent = 100;
+    std::cout.setf(std::ios::fixed);
+    std::cout << "SHA-256 kernel: " << Sha256Engine::get_kernel_name(engine.get_kernel()) << ", "
+              << std::setprecision(3) << sha256_ns << " ns/candidate, batches of "
+              << blocks.size() << " candidates\n"
+              << "   tasks  ns/poll  ns/candidate  % of SHA-256\n";
+
+    for (size_t tasks_count : {1, 2, 8, 64}) {
+        PollingScheduler scheduler;
+        uint64_t runs_count = 0;
+        for (size_t i = 0; i < tasks_count; ++i) {
+            scheduler.schedule_task(
+                "task " + std::to_string(i), [&]() { ++runs_count; }, std::chrono::hours(1));
+        }
+
+        // Run the tasks once, they are due when they are scheduled.
+        scheduler.poll();
+
+        const double poll_ns = measure_ns(polls_count, [&]() {
+            for (uint64_t i = 0; i < polls_count; ++i) {
+                scheduler.poll();
+            }
+        });
+        if (runs_count != tasks_count) {
+            std::cerr << "Unexpected tasks runs\n";
+            return EXIT_FAILURE;
+        }
+
+        const double candidate_ns = poll_ns / blocks.size();
+        std::cout << std::setw(8) << tasks_count << std::setw(9) << std::setprecision(2) << poll_ns
+                  << std::setw(14) << std::setprecision(4) << candidate_ns << std::setw(14)
+                  << std::setprecision(3) << candidate_ns / sha256_ns * percent << "\n";
+    }
+
+    return EXIT_SUCCESS;
+}
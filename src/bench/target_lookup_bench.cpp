@@ -0,0 +1,121 @@
+/**
+ * @brief Benchmark of the TargetSet lookup, one digest at a time against the prefetching batch
+ * lookup, for several hash list sizes.
+ *
+ * Usage: target_lookup_bench [targets_count...]
+ * Default sizes: 1000 1000000 100000000.
+ */
+
+#include "../TargetSet.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t queries_count = 1 << 20;
+constexpr size_t batch_size    = 64;
+constexpr size_t passes        = 5;
+
+// One query out of hit_period is a known hash, the rest miss like most candidates do.
+constexpr size_t hit_period = 1024;
+
+Sha256Engine::Digest random_digest(std::mt19937_64 &generator)
+{
+    Sha256Engine::Digest digest;
+    for (size_t i = 0; i < digest.size(); i += sizeof(uint64_t)) {
+        const uint64_t value = generator();
+        for (size_t j = 0; j < sizeof(uint64_t); ++j) {
+            digest[i + j] = static_cast<uint8_t>(value >> (j * 8));
+        }
+    }
+    return digest;
+}
+
+template <typename Function> double measure_ns_per_query(Function &&function)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t pass = 0; pass < passes; ++pass) {
+        function();
+    }
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (passes * queries_count);
+}
+
+void run_benchmark(size_t targets_count)
+{
+    std::mt19937_64 generator(targets_count);
+
+    std::vector<Sha256Engine::Digest> digests(targets_count);
+    for (auto &digest : digests) {
+        digest = random_digest(generator);
+    }
+
+    std::vector<Sha256Engine::Digest> queries(queries_count);
+    for (size_t i = 0; i < queries_count; ++i) {
+        queries[i] = (i % hit_period == 0) ? digests[generator() % targets_count]
+                                           : random_digest(generator);
+    }
+
+    TargetSet target_set(std::move(digests));
+
+    size_t single_matches = 0;
+    const auto single_ns  = measure_ns_per_query([&]() {
+        for (const auto &query : queries) {
+            single_matches += target_set.find(query).has_value();
+        }
+    });
+
+    size_t batch_matches = 0;
+    const auto batch_ns  = measure_ns_per_query([&]() {
+        std::vector<TargetSet::sMatch> matches(batch_size);
+        for (size_t i = 0; i < queries_count; i += batch_size) {
+            batch_matches += target_set.find_batch(&queries[i], batch_size, matches.data());
+        }
+    });
+
+    if (single_matches != batch_matches) {
+        std::cerr << "Mismatch: " << single_matches << " single matches, " << batch_matches
+                  << " batch matches\n";
+    }
+
+    std::cout << std::setw(12) << targets_count << std::setw(16) << std::setprecision(2)
+              << single_ns << std::setw(16) << batch_ns << "\n";
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    std::vector<size_t> targets_counts;
+    for (auto arg_index = 1; arg_index < argc; ++arg_index) {
+        targets_counts.push_back(std::strtoull(argv[arg_index], nullptr, 10));
+    }
+    if (targets_counts.empty()) {
+        targets_counts = {1000, 1000000, 100000000};
+    }
+
+    std::cout.setf(std::ios::fixed);
+    std::cout << std::setw(12) << "targets" << std::setw(16) << "single ns/q" << std::setw(16)
+              << "batch ns/q"
+              << "\n";
+
+    for (auto targets_count : targets_counts) {
+        if (targets_count == 0) {
+            continue;
+        }
+
+        try {
+            run_benchmark(targets_count);
+        } catch (const std::bad_alloc &) {
+            std::cout << std::setw(12) << targets_count << "  not enough memory, skipped\n";
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
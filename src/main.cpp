@@ -1,14 +1,30 @@
-#include "BaseOperationsUtils.h"
 #include "GlobalDefintions.h"
 #include "HashCrackerManager.h"
+#include "Sha256Engine.h"
 #include "UiUtils.h"
 
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <iomanip>
 #include <iostream>
 
 bool single_thread = false;
+sHashCrackerConfig hash_cracker_config;
+auto keyspace_distribution = KeyspaceScheduler::eDistribution::CONTIGUOUS;
+
+// Unless set by --max-len, crack up to 5 characters, about 62M permutations with valid_chars.
+constexpr size_t default_max_permutation_size = 5;
+
+/**
+ * @brief Get the keyspace of the attack set in @a config, the mask attack or the brute force of
+ * valid_chars, within the lengths bounds.
+ */
+Keyspace get_keyspace(const sHashCrackerConfig& config)
+{
+    return Keyspace(config.mask ? *config.mask : Mask::from_charset(valid_chars),
+        config.min_permutation_size, config.max_permutation_size);
+}
 
 std::vector<std::string_view> hash_list = {
     "/PtjJboZGlsmTovvyOhBOoTVnQKUP/gJXxjLAW9Lppw=", "05HwH93tksb69U1ifesCQuYFP+gKPVH2L6W8JeBdXy0=",
@@ -72,49 +88,75 @@ void full_flow_demo()
 
     std::cout << num_thread_supported << " concurrent threads are supported\n";
 
+    // Selecting the kernel runs its self-test, do it once before the threads are created.
+    std::cout << "SHA-256 kernel: "
+              << Sha256Engine::get_kernel_name(Sha256Engine::get_best_kernel()) << "\n";
+
     uint32_t discovered_passwords_count = 0;
 
     /* Creation of HashCrackerManager  */
 
     uint32_t thread_id = 0;
     // Main thread
-    HashCrackerManager main_thread_hash_cracker_manager(thread_id, discovered_passwords_count);
+    HashCrackerManager main_thread_hash_cracker_manager(
+        thread_id, discovered_passwords_count, hash_cracker_config);
 
     // Other threads
     std::vector<std::shared_ptr<HashCrackerManager>> hash_cracker_thread_managers;
 
     // Create more working thread and push the into the pool
     for (thread_id = 1; thread_id < num_thread_supported; ++thread_id) {
-        hash_cracker_thread_managers.emplace_back(
-            std::make_unique<HashCrackerManager>(thread_id, discovered_passwords_count));
+        hash_cracker_thread_managers.emplace_back(std::make_unique<HashCrackerManager>(
+            thread_id, discovered_passwords_count, hash_cracker_config));
     }
 
     /* HashCrackerManager initialization */
+    // The hash list is decoded once, and shared by all the threads.
+    auto target_set = std::make_shared<TargetSet>(hash_list);
+
+    // The keyspace is split into chunks that the threads take, and steal from each other, until
+    // all of it is done. Each range is a range of the keyspace indices, see Keyspace, or of the
+    // wordlist offsets, see Wordlist, or of both in a hybrid attack, or of two wordlists in a
+    // combinator attack, see HashGenerator.
+    std::shared_ptr<KeyspaceScheduler> keyspace_scheduler;
+    const auto& right_wordlist = hash_cracker_config.right_wordlist;
+    if (const auto& wordlist = hash_cracker_config.wordlist; wordlist && right_wordlist) {
+        std::cout << "Wordlists: " << wordlist->size() << " bytes, each word followed by each "
+                  << "word of " << right_wordlist->size() << " bytes\n";
+        keyspace_scheduler = std::make_shared<KeyspaceScheduler>(
+            0, wordlist->size() * right_wordlist->size(), num_thread_supported);
+    } else if (wordlist && hash_cracker_config.mask) {
+        const auto keyspace = get_keyspace(hash_cracker_config);
+        std::cout << "Wordlist: " << wordlist->size() << " bytes, each word "
+                  << (hash_cracker_config.mask_position == HashGenerator::eMaskPosition::APPEND
+                             ? "followed"
+                             : "preceded")
+                  << " by " << keyspace.size() << " mask candidates of lengths "
+                  << keyspace.get_min_size() << " to " << keyspace.get_max_size() << "\n";
+        keyspace_scheduler = std::make_shared<KeyspaceScheduler>(
+            0, wordlist->size() * keyspace.size(), num_thread_supported);
+    } else if (wordlist) {
+        std::cout << "Wordlist: " << wordlist->size() << " bytes";
+        if (hash_cracker_config.rules) {
+            std::cout << ", each word mangled by " << hash_cracker_config.rules->size() << " rules";
+        }
+        std::cout << "\n";
+        keyspace_scheduler =
+            std::make_shared<KeyspaceScheduler>(0, wordlist->size(), num_thread_supported);
+    } else {
+        const auto keyspace = get_keyspace(hash_cracker_config);
+        std::cout << "Keyspace: lengths " << keyspace.get_min_size() << " to "
+                  << keyspace.get_max_size() << ", " << keyspace.size() << " permutations\n";
+        keyspace_scheduler = std::make_shared<KeyspaceScheduler>(
+            keyspace, 0, keyspace.size(), num_thread_supported, keyspace_distribution);
+    }
+
     // Main thread
-    main_thread_hash_cracker_manager.init(hash_cracker_thread_managers, hash_list);
+    main_thread_hash_cracker_manager.init(target_set, keyspace_scheduler);
 
     // Other threads
     for (auto& hash_cracker_manager : hash_cracker_thread_managers) {
-        hash_cracker_manager->init(
-            hash_cracker_thread_managers, hash_list, &main_thread_hash_cracker_manager);
-    }
-
-    /* Set HashCrackerManagers task */
-    std::string initial_permutation("");
-    constexpr uint32_t permutations_job = 100000000;
-    const std::string permutations_job_base_str =
-        BaseOperationsUtils::decimal_to_base_x(permutations_job, valid_chars);
-
-    for (thread_id = 0; thread_id < num_thread_supported; ++thread_id) {
-        auto& hash_cracker_manager =
-            (thread_id == 0 ? main_thread_hash_cracker_manager
-                            : *hash_cracker_thread_managers[thread_id - 1]);
-
-        auto msg = std::make_unique<sMSG_SET_TASK>(initial_permutation, permutations_job);
-        hash_cracker_manager.send_message(std::move(msg));
-
-        initial_permutation = BaseOperationsUtils::sum_base_x_integers(
-            initial_permutation, permutations_job_base_str, valid_chars);
+        hash_cracker_manager->init(target_set, keyspace_scheduler);
     }
 
     /* Start HashCrackerManagers threads */
@@ -137,13 +179,26 @@ void full_flow_demo()
 
         main_thread_hash_cracker_manager.handle_messages();
 
-        uint64_t rate = -1;
+        // Average the prefilter false positive rate of the threads which use it.
+        double false_positive_rate_sum     = 0;
+        uint32_t false_positive_rate_count = 0;
+        auto add_false_positive_rate       = [&](const HashCrackerManager& hash_cracker_manager) {
+            auto false_positive_rate = hash_cracker_manager.get_prefilter_false_positive_rate();
+            if (false_positive_rate >= 0) {
+                false_positive_rate_sum += false_positive_rate;
+                ++false_positive_rate_count;
+            }
+        };
+
+        uint64_t rate = 0;
         if (main_thread_hash_cracker_manager.get_hash_rate() != static_cast<uint64_t>(-1)) {
             rate += main_thread_hash_cracker_manager.get_hash_rate();
         }
+        add_false_positive_rate(main_thread_hash_cracker_manager);
 
         for (auto& hash_cracker_manager : hash_cracker_thread_managers) {
             hash_cracker_manager->handle_messages_thread_safe();
+            add_false_positive_rate(*hash_cracker_manager);
 
             if (hash_cracker_manager->get_hash_rate() == static_cast<uint64_t>(-1)) {
                 continue;
@@ -151,7 +206,7 @@ void full_flow_demo()
             rate += hash_cracker_manager->get_hash_rate();
         }
 
-        if (rate == static_cast<uint64_t>(-1)) {
+        if (keyspace_scheduler->is_done()) {
             break;
         }
 
@@ -163,24 +218,195 @@ void full_flow_demo()
                   //<< "\033[0F" // Remove the previous print to prevent screen flooding.
                   << "HashRate=" << std::setprecision(2) << hash_rate << hash_rate_str
                   << ", total passwords discoveries: " << discovered_passwords_count << "/"
-                  << hash_list.size()
-                  << "                                                                          \n";
+                  << target_set->size() << ", progress: " << std::setprecision(2)
+                  << 100.0 * keyspace_scheduler->get_completed_count() / keyspace_scheduler->size()
+                  << "%";
+
+        if (false_positive_rate_count) {
+            constexpr double percent = 100;
+            std::cout << ", prefilter false positives: " << std::setprecision(4)
+                      << false_positive_rate_sum / false_positive_rate_count * percent << "%";
+        }
+
+        std::cout << "                                                                          \n";
+    }
+
+    // The threads which didn't report FINISHED_TASK yet may wait for messages, stop them all so
+    // they leave their loop within the idle timeout.
+    for (auto& hash_cracker_manager : hash_cracker_thread_managers) {
+        auto& thread = hash_cracker_manager->get_thread();
+        if (thread.is_thread_running()) {
+            thread.stop_thread();
+        }
     }
 
     for (auto& hash_cracker_manager : hash_cracker_thread_managers) {
         hash_cracker_manager->get_thread().join_thread();
     }
+
+    // Handle the messages sent after the last update, so no discovery is lost.
+    main_thread_hash_cracker_manager.handle_messages();
+    for (auto& hash_cracker_manager : hash_cracker_thread_managers) {
+        hash_cracker_manager->handle_messages_thread_safe();
+    }
 }
 
 int main(int argc, char* argv[])
 {
+    std::optional<size_t> min_permutation_size;
+    std::optional<size_t> max_permutation_size;
+    std::string_view mask;
+    std::vector<std::string> custom_charsets(Mask::max_custom_charsets);
+
     for (auto arg_index = 0; arg_index < argc; ++arg_index) {
         if (std::string_view(argv[arg_index]) == "-s") {
             std::cout << "single thread mode\n";
             single_thread = true;
+        } else if (std::string_view(argv[arg_index]) == "--no-early-reject") {
+            std::cout << "early reject disabled\n";
+            hash_cracker_config.early_reject = false;
+        } else if (std::string_view(argv[arg_index]) == "--prefilter-bits" &&
+                   arg_index + 1 < argc) {
+            // Log2 of the prefilter size in bits, 0 disables the prefilter.
+            int bits_log2 = std::atoi(argv[++arg_index]);
+            if (bits_log2 != 0 && (bits_log2 < TargetPrefilter::min_bits_log2 ||
+                                      bits_log2 > TargetPrefilter::max_bits_log2)) {
+                std::cerr << "--prefilter-bits must be 0 or between "
+                          << int(TargetPrefilter::min_bits_log2) << " and "
+                          << int(TargetPrefilter::max_bits_log2) << "\n";
+                return EXIT_FAILURE;
+            }
+            std::cout << "prefilter bits log2: " << bits_log2 << "\n";
+            hash_cracker_config.prefilter_bits_log2 = static_cast<uint8_t>(bits_log2);
+        } else if (std::string_view(argv[arg_index]) == "--distribution" &&
+                   arg_index + 1 < argc) {
+            // How the keyspace is split between the threads, see KeyspaceScheduler.
+            std::string_view distribution(argv[++arg_index]);
+            if (distribution == "contiguous") {
+                keyspace_distribution = KeyspaceScheduler::eDistribution::CONTIGUOUS;
+            } else if (distribution == "length-major") {
+                keyspace_distribution = KeyspaceScheduler::eDistribution::LENGTH_MAJOR;
+            } else {
+                std::cerr << "--distribution must be contiguous or length-major\n";
+                return EXIT_FAILURE;
+            }
+            std::cout << "keyspace distribution: " << distribution << "\n";
+        } else if (std::string_view(argv[arg_index]) == "--message-transport" &&
+                   arg_index + 1 < argc) {
+            // How the messages move between the threads, see ThreadMessageIO.
+            std::string_view transport(argv[++arg_index]);
+            if (transport == "mutex") {
+                hash_cracker_config.message_transport = eMessageTransport::MUTEX_QUEUES;
+            } else if (transport == "spsc") {
+                hash_cracker_config.message_transport = eMessageTransport::SPSC_RING_BUFFERS;
+            } else {
+                std::cerr << "--message-transport must be mutex or spsc\n";
+                return EXIT_FAILURE;
+            }
+            std::cout << "message transport: " << transport << "\n";
+        } else if (std::string_view(argv[arg_index]) == "--min-len" && arg_index + 1 < argc) {
+            min_permutation_size = std::strtoul(argv[++arg_index], nullptr, 10);
+        } else if (std::string_view(argv[arg_index]) == "--max-len" && arg_index + 1 < argc) {
+            max_permutation_size = std::strtoul(argv[++arg_index], nullptr, 10);
+        } else if (std::string_view(argv[arg_index]) == "--wordlist" && arg_index + 1 < argc) {
+            // Wordlist attack, one word per line, see Wordlist.
+            hash_cracker_config.wordlist = Wordlist::open(argv[++arg_index]);
+            if (!hash_cracker_config.wordlist) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "wordlist attack: " << argv[arg_index] << "\n";
+        } else if (std::string_view(argv[arg_index]) == "--combinator" && arg_index + 1 < argc) {
+            // Combinator attack, each word of the wordlist followed by each word of this one.
+            hash_cracker_config.right_wordlist = Wordlist::open(argv[++arg_index]);
+            if (!hash_cracker_config.right_wordlist) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "combinator attack, right wordlist: " << argv[arg_index] << "\n";
+        } else if (std::string_view(argv[arg_index]) == "--prepend-mask") {
+            // Hybrid attack with the mask candidates before the words.
+            hash_cracker_config.mask_position = HashGenerator::eMaskPosition::PREPEND;
+        } else if (std::string_view(argv[arg_index]) == "--rules" && arg_index + 1 < argc) {
+            // Rules which mangle the words of the wordlist attack, see RuleSet.
+            auto rules = RuleSet::load(argv[++arg_index]);
+            if (!rules) {
+                return EXIT_FAILURE;
+            }
+            std::cout << "rules: " << argv[arg_index] << ", " << rules->size() << " rules\n";
+            hash_cracker_config.rules = std::make_shared<RuleSet>(std::move(*rules));
+        } else if (std::string_view(argv[arg_index]) == "--mask" && arg_index + 1 < argc) {
+            // Mask attack, e.g. "?u?l?l?l?d?d?d?d", see Mask.
+            mask = argv[++arg_index];
+        } else if (arg_index + 1 < argc && argv[arg_index][0] == '-' &&
+                   argv[arg_index][1] >= '1' &&
+                   argv[arg_index][1] < char('1' + Mask::max_custom_charsets) &&
+                   argv[arg_index][2] == '\0') {
+            // Custom charsets of the mask, -1 to -4 for ?1 to ?4.
+            custom_charsets[argv[arg_index][1] - '1'] = argv[arg_index + 1];
+            ++arg_index;
         }
     }
 
+    if (hash_cracker_config.rules && !hash_cracker_config.wordlist) {
+        std::cerr << "--rules requires --wordlist\n";
+        return EXIT_FAILURE;
+    }
+    if (hash_cracker_config.rules && !mask.empty()) {
+        std::cerr << "--rules cannot be combined with --mask\n";
+        return EXIT_FAILURE;
+    }
+    if (hash_cracker_config.right_wordlist &&
+        (!hash_cracker_config.wordlist || hash_cracker_config.rules || !mask.empty())) {
+        std::cerr << "--combinator requires --wordlist, and cannot be combined with --rules or "
+                     "--mask\n";
+        return EXIT_FAILURE;
+    }
+    if (hash_cracker_config.mask_position == HashGenerator::eMaskPosition::PREPEND &&
+        (!hash_cracker_config.wordlist || mask.empty())) {
+        std::cerr << "--prepend-mask requires --wordlist and --mask\n";
+        return EXIT_FAILURE;
+    }
+
+    if (!mask.empty()) {
+        hash_cracker_config.mask = Mask::parse(mask, custom_charsets);
+        if (!hash_cracker_config.mask) {
+            return EXIT_FAILURE;
+        }
+        std::cout << (hash_cracker_config.wordlist ? "hybrid attack, mask: " : "mask attack: ")
+                  << mask << "\n";
+    }
+
+    // Lengths bounds of the keyspace. A mask attack is of the mask length unless set otherwise.
+    const auto& config_mask                  = hash_cracker_config.mask;
+    hash_cracker_config.min_permutation_size = min_permutation_size.value_or(
+        config_mask ? config_mask->size() : 1);
+    hash_cracker_config.max_permutation_size = max_permutation_size.value_or(
+        config_mask ? config_mask->size() : default_max_permutation_size);
+
+    const auto keyspace = get_keyspace(hash_cracker_config);
+    if (hash_cracker_config.min_permutation_size < 1 ||
+        hash_cracker_config.min_permutation_size > hash_cracker_config.max_permutation_size ||
+        keyspace.get_max_size() != hash_cracker_config.max_permutation_size) {
+        auto unbounded_config                 = hash_cracker_config;
+        unbounded_config.min_permutation_size = 1;
+        unbounded_config.max_permutation_size = Mask::max_size;
+        std::cerr << "--min-len and --max-len must satisfy 1 <= min-len <= max-len <= "
+                  << get_keyspace(unbounded_config).get_max_size() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // The hybrid indices are the wordlist offsets times the mask keyspace size.
+    const auto& wordlist = hash_cracker_config.wordlist;
+    if (wordlist && config_mask && wordlist->size() > UINT64_MAX / keyspace.size()) {
+        std::cerr << "The hybrid attack is too large, use a shorter wordlist or mask\n";
+        return EXIT_FAILURE;
+    }
+    const auto& right_wordlist = hash_cracker_config.right_wordlist;
+    if (wordlist && right_wordlist && right_wordlist->size() &&
+        wordlist->size() > UINT64_MAX / right_wordlist->size()) {
+        std::cerr << "The combinator attack is too large, use shorter wordlists\n";
+        return EXIT_FAILURE;
+    }
+
     try {
         full_flow_demo();
         std::cout << "Demo finished\n";
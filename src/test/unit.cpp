@@ -1,10 +1,29 @@
 #include "../BaseOperationsUtils.h"
+#include "../CandidateOdometer.h"
 #include "../HashGenerator.h"
+#include "../Keyspace.h"
+#include "../KeyspaceScheduler.h"
+#include "../Mask.h"
+#include "../PollingScheduler.h"
+#include "../RuleSet.h"
+#include "../Sha256Engine.h"
+#include "../TargetPrefilter.h"
+#include "../TargetScanner.h"
+#include "../TargetSet.h"
+#include "../ThreadMessageIO.h"
 #include "../UiUtils.h"
+#include "../Wordlist.h"
 #include "../external/include/base64.h"
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <gtest/gtest.h>
+#include <map>
+#include <numeric>
+#include <set>
 #include <sha256.h>
+#include <thread>
 #include <tuple>
 
 TEST(Flow, demo_password)
@@ -63,7 +82,997 @@ TEST(HashGenerator, basic_functionality)
 
     EXPECT_STREQ(hash_generator.get_current_permutation().data(), "password1");
 
-    EXPECT_STREQ(hash.data(), "tDdmKQpMiVDFA1YdblkHSFzL4Z9UIQ9FSouf3TybOu0=");
+    EXPECT_STREQ(base64_encode(hash.data(), hash.size()).c_str(),
+        "tDdmKQpMiVDFA1YdblkHSFzL4Z9UIQ9FSouf3TybOu0=");
+}
+
+TEST(HashGenerator, next_hashes)
+{
+    constexpr std::string_view salt        = "IEEE";
+    constexpr std::string_view pepper      = "Xtreme";
+    constexpr std::string_view valid_chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+    HashGenerator batch_generator(salt, pepper, valid_chars);
+    HashGenerator single_generator(salt, pepper, valid_chars);
+
+    // Start close to a length change, and include permutations too long for a single block.
+    const std::string initial_permutation(44, 'z');
+    batch_generator.set_initial_permutation(initial_permutation);
+    single_generator.set_initial_permutation(initial_permutation);
+
+    sHashBatch batch;
+    EXPECT_EQ(batch_generator.next_hashes(batch, 3), 3);
+    EXPECT_EQ(batch.size, 3);
+    EXPECT_EQ(batch_generator.next_hashes(batch), sHashBatch::capacity);
+
+    for (size_t i = 0; i < 3; ++i) {
+        single_generator.get_next_permutation_hash();
+    }
+
+    for (size_t i = 0; i < batch.size; ++i) {
+        auto hash = single_generator.get_next_permutation_hash();
+        EXPECT_EQ(batch.permutations[i], single_generator.get_current_permutation());
+        EXPECT_EQ(batch.hashes[i], hash);
+    }
+}
+
+TEST(HashGenerator, next_hashes_consecutive_batches)
+{
+    constexpr std::string_view valid_chars = "0123456789abcdefghijklmnopqrstuvwxyz";
+    HashGenerator batch_generator("IEEE", "Xtreme", valid_chars);
+    HashGenerator single_generator("IEEE", "Xtreme", valid_chars);
+
+    // The batches blocks are updated in place, across carries and a length change.
+    batch_generator.set_initial_permutation("zw0");
+    single_generator.set_initial_permutation("zw0");
+
+    sHashBatch batch;
+    for (size_t batch_index = 0; batch_index < 100; ++batch_index) {
+        ASSERT_EQ(batch_generator.next_hashes(batch), sHashBatch::capacity);
+
+        for (size_t i = 0; i < batch.size; ++i) {
+            auto hash = single_generator.get_next_permutation_hash();
+            ASSERT_EQ(batch.permutations[i], single_generator.get_current_permutation());
+            ASSERT_EQ(batch.hashes[i], hash) << batch.permutations[i];
+        }
+    }
+}
+
+TEST(Sha256Engine, kernels)
+{
+    // Messages of every length which fits in a single block.
+    constexpr size_t blocks_count = 56;
+    std::array<Sha256Engine::sBlock, blocks_count> blocks;
+    std::array<Sha256Engine::Digest, blocks_count> reference_digests;
+
+    for (size_t i = 0; i < blocks_count; ++i) {
+        auto &bytes = blocks[i].bytes;
+        std::fill(std::begin(bytes), std::end(bytes), 0);
+        for (size_t j = 0; j < i; ++j) {
+            bytes[j] = static_cast<uint8_t>('a' + (i + j) % 26);
+        }
+        bytes[i]  = 0x80;
+        bytes[62] = static_cast<uint8_t>((i * 8) >> 8);
+        bytes[63] = static_cast<uint8_t>(i * 8);
+
+        SHA256 sha256;
+        sha256.add(bytes, i);
+        sha256.getHash(reference_digests[i].data());
+    }
+
+    for (auto kernel : {Sha256Engine::eKernel::SCALAR, Sha256Engine::eKernel::AVX2,
+             Sha256Engine::eKernel::AVX512, Sha256Engine::eKernel::SHA_NI}) {
+        if (!Sha256Engine::is_kernel_supported(kernel)) {
+            std::cout << "Skip unsupported kernel " << Sha256Engine::get_kernel_name(kernel)
+                      << "\n";
+            continue;
+        }
+
+        Sha256Engine engine(kernel);
+        std::array<Sha256Engine::Digest, blocks_count> digests;
+        engine.hash_blocks(blocks.data(), digests.data(), digests.size());
+        EXPECT_EQ(digests, reference_digests) << Sha256Engine::get_kernel_name(kernel);
+
+        std::array<uint32_t, blocks_count> early_reject_words;
+        engine.hash_blocks_early_reject(
+            blocks.data(), early_reject_words.data(), early_reject_words.size());
+        for (size_t i = 0; i < blocks_count; ++i) {
+            EXPECT_EQ(early_reject_words[i],
+                Sha256Engine::get_early_reject_word(reference_digests[i]))
+                << Sha256Engine::get_kernel_name(kernel) << " message size " << i;
+        }
+    }
+}
+
+TEST(TargetSet, find_and_mark_cracked)
+{
+    const std::vector<std::string_view> hash_list = {
+        "tDdmKQpMiVDFA1YdblkHSFzL4Z9UIQ9FSouf3TybOu0=",
+        "/PtjJboZGlsmTovvyOhBOoTVnQKUP/gJXxjLAW9Lppw=",
+        "tDdmKQpMiVDFA1YdblkHSFzL4Z9UIQ9FSouf3TybOu0=", // Duplicated
+        "bm90IGEgaGFzaA==",                             // Not a SHA-256 hash
+    };
+    TargetSet target_set(hash_list);
+    EXPECT_EQ(target_set.size(), 2);
+
+    HashGenerator hash_generator("IEEE", "Xtreme", "0123456789abcdefghijklmnopqrstuvwxyz");
+    hash_generator.set_initial_permutation("password0");
+    auto digest = hash_generator.get_next_permutation_hash();
+
+    auto index = target_set.find(digest);
+    ASSERT_TRUE(index);
+    EXPECT_EQ(target_set.get_digest(*index), digest);
+    EXPECT_EQ(target_set.get_encoded_hash(*index), hash_list[0]);
+
+    // Only the first thread to mark the hash cracks it.
+    std::atomic<size_t> successful_marks = 0;
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            if (target_set.mark_cracked(*index)) {
+                ++successful_marks;
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(successful_marks, 1);
+    EXPECT_TRUE(target_set.is_cracked(*index));
+    EXPECT_EQ(target_set.get_cracked_count(), 1);
+
+    // A cracked hash is not found anymore.
+    EXPECT_FALSE(target_set.find(digest));
+}
+
+TEST(TargetSet, large_hash_list)
+{
+    constexpr size_t hashes_count = 100000;
+
+    std::vector<Sha256Engine::Digest> digests(hashes_count + 1);
+    std::vector<std::string> encoded_hashes;
+    for (size_t i = 0; i < digests.size(); ++i) {
+        SHA256 sha256;
+        sha256.add(&i, sizeof(i));
+        sha256.getHash(digests[i].data());
+        encoded_hashes.push_back(base64_encode(digests[i].data(), digests[i].size()));
+    }
+
+    // The last digest is not in the list.
+    TargetSet target_set(
+        std::vector<std::string_view>(encoded_hashes.begin(), encoded_hashes.end() - 1));
+    EXPECT_EQ(target_set.size(), hashes_count);
+    EXPECT_FALSE(target_set.find(digests.back()));
+
+    // Crack every other hash, the rest must still be found through the tombstones.
+    for (size_t i = 0; i < hashes_count; i += 2) {
+        auto index = target_set.find(digests[i]);
+        ASSERT_TRUE(index) << i;
+        EXPECT_TRUE(target_set.mark_cracked(*index));
+    }
+    for (size_t i = 0; i < hashes_count; ++i) {
+        EXPECT_EQ(target_set.find(digests[i]).has_value(), i % 2 == 1) << i;
+    }
+    EXPECT_EQ(target_set.get_cracked_count(), hashes_count / 2);
+
+    // The batch lookup finds the same hashes.
+    std::vector<TargetSet::sMatch> matches(digests.size());
+    auto matches_count = target_set.find_batch(digests.data(), digests.size(), matches.data());
+    ASSERT_EQ(matches_count, hashes_count / 2);
+    for (size_t i = 0; i < matches_count; ++i) {
+        EXPECT_EQ(matches[i].digest_index % 2, 1);
+        EXPECT_EQ(target_set.get_digest(matches[i].target_index), digests[matches[i].digest_index]);
+    }
+}
+
+TEST(TargetPrefilter, false_positives)
+{
+    constexpr size_t hashes_count = 1000;
+    constexpr size_t tests_count  = 100000;
+
+    std::vector<Sha256Engine::Digest> digests(hashes_count + tests_count);
+    std::vector<std::string> encoded_hashes;
+    for (size_t i = 0; i < digests.size(); ++i) {
+        SHA256 sha256;
+        sha256.add(&i, sizeof(i));
+        sha256.getHash(digests[i].data());
+        encoded_hashes.push_back(base64_encode(digests[i].data(), digests[i].size()));
+    }
+
+    TargetSet target_set(std::vector<std::string_view>(
+        encoded_hashes.begin(), encoded_hashes.begin() + hashes_count));
+    TargetPrefilter prefilter(16, target_set);
+
+    // No false negatives.
+    for (size_t i = 0; i < hashes_count; ++i) {
+        EXPECT_TRUE(prefilter.may_contain(digests[i])) << i;
+    }
+
+    size_t false_positives = 0;
+    for (size_t i = hashes_count; i < digests.size(); ++i) {
+        false_positives += prefilter.may_contain(digests[i]);
+    }
+    EXPECT_LT(false_positives, tests_count / 100);
+
+    // A cracked hash is removed from the filter when it is rebuilt.
+    target_set.mark_cracked(*target_set.find(digests[0]));
+    EXPECT_TRUE(prefilter.may_contain(digests[0]));
+    prefilter.build(target_set);
+    EXPECT_FALSE(prefilter.may_contain(digests[0]));
+}
+
+TEST(TargetScanner, contains)
+{
+    TargetScanner scanner;
+    EXPECT_FALSE(scanner.contains(0));
+
+    // Sizes around the vector width, and the maximal size.
+    for (size_t keys_count : {1, 7, 8, 9, 100, 256}) {
+        std::vector<uint32_t> keys;
+        for (size_t i = 0; i < keys_count; ++i) {
+            keys.push_back(static_cast<uint32_t>(i * 2 + 1));
+        }
+        ASSERT_TRUE(scanner.set_keys(keys));
+
+        for (size_t i = 0; i < keys_count * 2 + 2; ++i) {
+            EXPECT_EQ(scanner.contains(static_cast<uint32_t>(i)), i % 2 == 1 && i < keys_count * 2)
+                << "keys count " << keys_count << " key " << i;
+        }
+    }
+
+    EXPECT_FALSE(scanner.set_keys(std::vector<uint32_t>(TargetScanner::max_keys + 1)));
+    EXPECT_TRUE(scanner.set_keys({}));
+    EXPECT_FALSE(scanner.contains(0));
+}
+
+TEST(CandidateOdometer, increment)
+{
+    for (std::string_view base_characters : {"01", "abc", "0123456789abcdefghijklmnopqrstuvwxyz"}) {
+        CandidateOdometer odometer(base_characters);
+        Keyspace keyspace(base_characters);
+
+        for (uint64_t index = 0; index < 5000; ++index) {
+            const std::string previous(odometer.get());
+            auto changed_position = odometer.increment();
+            const auto reference  = keyspace.get_candidate(index);
+
+            ASSERT_TRUE(reference);
+            ASSERT_EQ(odometer.get(), *reference);
+            ASSERT_EQ(odometer.get().data()[odometer.size()], '\0');
+
+            // Nothing changed left of the changed position.
+            if (previous.size() == reference->size()) {
+                ASSERT_LT(changed_position, reference->size());
+                EXPECT_EQ(previous.substr(0, changed_position),
+                    reference->substr(0, changed_position));
+                EXPECT_NE(previous[changed_position], (*reference)[changed_position]);
+            } else {
+                EXPECT_EQ(changed_position, 0);
+            }
+        }
+    }
+
+    CandidateOdometer odometer("0123456789");
+    EXPECT_TRUE(odometer.set("98"));
+    EXPECT_EQ(odometer.increment(), 1);
+    EXPECT_EQ(odometer.get(), "99");
+    EXPECT_EQ(odometer.increment(), 0);
+    EXPECT_EQ(odometer.get(), "000");
+
+    EXPECT_FALSE(odometer.set("12a"));
+    EXPECT_FALSE(odometer.set(std::string(CandidateOdometer::max_size + 1, '0')));
+    EXPECT_EQ(odometer.get(), "000");
+}
+
+TEST(Keyspace, index_to_candidate)
+{
+    Keyspace keyspace("abc");
+    EXPECT_EQ(keyspace.get_candidate(0), "a");
+    EXPECT_EQ(keyspace.get_candidate(2), "c");
+    EXPECT_EQ(keyspace.get_candidate(3), "aa");
+    EXPECT_EQ(keyspace.get_candidate(4), "ab");
+    EXPECT_EQ(keyspace.get_candidate(11), "cc");
+    EXPECT_EQ(keyspace.get_candidate(12), "aaa");
+    EXPECT_EQ(keyspace.get_first_index(3), 12);
+    EXPECT_EQ(keyspace.get_previous_candidate(0), "");
+    EXPECT_EQ(keyspace.get_previous_candidate(12), "cc");
+    EXPECT_FALSE(keyspace.get_index(""));
+    EXPECT_FALSE(keyspace.get_index("abd"));
+
+    // Round trip around the lengths boundaries, up to the last index of the keyspace.
+    Keyspace base36_keyspace("0123456789abcdefghijklmnopqrstuvwxyz");
+    EXPECT_EQ(base36_keyspace.get_max_size(), 12);
+    for (size_t size = 1; size <= base36_keyspace.get_max_size() + 1; ++size) {
+        const auto first_index = base36_keyspace.get_first_index(size);
+        for (auto index : {first_index - 1, first_index, first_index + 1}) {
+            const auto candidate = base36_keyspace.get_candidate(index);
+            if (index >= base36_keyspace.size()) {
+                EXPECT_FALSE(candidate);
+                continue;
+            }
+            ASSERT_TRUE(candidate) << index;
+            EXPECT_EQ(base36_keyspace.get_index(*candidate), index) << *candidate;
+        }
+    }
+    EXPECT_EQ(base36_keyspace.get_candidate(base36_keyspace.size() - 1), std::string(12, 'z'));
+    EXPECT_FALSE(base36_keyspace.get_index(std::string(13, '0')));
+    EXPECT_FALSE(base36_keyspace.get_previous_candidate(base36_keyspace.size() + 1));
+
+    // The generator continues from the candidate at the index.
+    HashGenerator hash_generator("IEEE", "Xtreme", "0123456789abcdefghijklmnopqrstuvwxyz");
+    const auto index = *base36_keyspace.get_index("password1");
+    ASSERT_TRUE(hash_generator.set_next_index(index));
+    hash_generator.get_next_permutation_hash();
+    EXPECT_EQ(hash_generator.get_current_permutation(), "password1");
+    ASSERT_TRUE(hash_generator.set_next_index(0));
+    hash_generator.get_next_permutation_hash();
+    EXPECT_EQ(hash_generator.get_current_permutation(), "0");
+    EXPECT_FALSE(hash_generator.set_next_index(base36_keyspace.size() + 1));
+}
+
+TEST(Keyspace, lengths_bounds)
+{
+    // Lengths 2 and 3 of "abc", 9 + 27 permutations.
+    Keyspace keyspace("abc", 2, 3);
+    EXPECT_EQ(keyspace.size(), 36);
+    EXPECT_EQ(keyspace.get_min_size(), 2);
+    EXPECT_EQ(keyspace.get_max_size(), 3);
+    EXPECT_EQ(keyspace.get_first_index(2), 0);
+    EXPECT_EQ(keyspace.get_first_index(3), 9);
+    EXPECT_EQ(keyspace.get_candidate_size(8), 2);
+    EXPECT_EQ(keyspace.get_candidate_size(9), 3);
+    EXPECT_EQ(keyspace.get_candidate(0), "aa");
+    EXPECT_EQ(keyspace.get_candidate(35), "ccc");
+    EXPECT_FALSE(keyspace.get_candidate(36));
+    EXPECT_EQ(keyspace.get_previous_candidate(0), "c");
+    EXPECT_FALSE(keyspace.get_index("c"));
+    EXPECT_FALSE(keyspace.get_index("aaaa"));
+
+    // The maximal length is lowered to what fits in 64 bits indices.
+    EXPECT_EQ(Keyspace("0123456789abcdefghijklmnopqrstuvwxyz", 8, 20).get_max_size(), 12);
+    EXPECT_EQ(Keyspace("0123456789abcdefghijklmnopqrstuvwxyz", 13, 20).size(), 0);
+
+    // The generator walks the whole bounded keyspace.
+    HashGenerator hash_generator("IEEE", "Xtreme", "abc", 2, 3);
+    ASSERT_TRUE(hash_generator.set_next_index(0));
+    for (uint64_t index = 0; index < keyspace.size(); ++index) {
+        hash_generator.get_next_permutation_hash();
+        EXPECT_EQ(hash_generator.get_current_permutation(), keyspace.get_candidate(index));
+    }
+
+    // Each chunk has a single length, even in a contiguous share.
+    KeyspaceScheduler scheduler(keyspace, 0, 100, 1);
+    EXPECT_EQ(scheduler.size(), 36);
+    auto chunk = scheduler.next_chunk(0, 100);
+    ASSERT_TRUE(chunk);
+    EXPECT_EQ(chunk->begin, 0);
+    EXPECT_EQ(chunk->end, 9);
+    chunk = scheduler.next_chunk(0, 100);
+    ASSERT_TRUE(chunk);
+    EXPECT_EQ(chunk->begin, 9);
+    EXPECT_EQ(chunk->end, 36);
+}
+
+TEST(Mask, parse)
+{
+    auto mask = Mask::parse("?u?d?1??x", {"ab?d"});
+    ASSERT_TRUE(mask);
+    EXPECT_EQ(mask->size(), 5);
+    EXPECT_EQ(mask->get_charset(0), "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    EXPECT_EQ(mask->get_charset(1), "0123456789");
+    EXPECT_EQ(mask->get_charset(2), "ab0123456789");
+    EXPECT_EQ(mask->get_charset(3), "?");
+    EXPECT_EQ(mask->get_charset(4), "x");
+
+    // The distinct charsets are kept once.
+    mask = Mask::parse("?l?l?d?l");
+    ASSERT_TRUE(mask);
+    EXPECT_EQ(mask->get_charsets().size(), 2);
+    EXPECT_EQ(mask->get_charset_index(3), 0);
+    EXPECT_EQ(Mask::parse("?a")->get_charset(0).size(), 95);
+
+    EXPECT_FALSE(Mask::parse(""));
+    EXPECT_FALSE(Mask::parse("?x"));
+    EXPECT_FALSE(Mask::parse("ab?"));
+    EXPECT_FALSE(Mask::parse("?2", {"ab"}));
+    EXPECT_FALSE(Mask::parse("?1", {"", "ab"}));
+    EXPECT_FALSE(Mask::parse("?1", {"?z"}));
+    EXPECT_FALSE(Mask::parse(std::string(Mask::max_size + 1, 'a')));
+}
+
+TEST(Keyspace, mask)
+{
+    // 26 * 10 * 2 permutations of 3 characters.
+    auto mask = Mask::parse("?u?d?1", {"ab"});
+    ASSERT_TRUE(mask);
+    Keyspace keyspace(*mask, 1, Mask::max_size);
+    EXPECT_EQ(keyspace.get_max_size(), 3);
+    EXPECT_EQ(keyspace.get_first_index(3), 26 + 26 * 10);
+    EXPECT_EQ(keyspace.size(), 26 + 26 * 10 + 26 * 10 * 2);
+    EXPECT_EQ(keyspace.get_candidate(0), "A");
+    EXPECT_EQ(keyspace.get_candidate(26), "A0");
+    EXPECT_EQ(keyspace.get_candidate(keyspace.size() - 1), "Z9b");
+    EXPECT_EQ(keyspace.get_index("B0a"), 26 + 26 * 10 + 20);
+    EXPECT_FALSE(keyspace.get_index("0"));
+    EXPECT_FALSE(keyspace.get_index("A0c"));
+
+    // The generator walks the mask in the keyspace order.
+    HashGenerator hash_generator("IEEE", "Xtreme", *mask, 1, Mask::max_size);
+    ASSERT_TRUE(hash_generator.set_next_index(0));
+    for (uint64_t index = 0; index < keyspace.size(); ++index) {
+        hash_generator.get_next_permutation_hash();
+        EXPECT_EQ(hash_generator.get_current_permutation(), keyspace.get_candidate(index));
+    }
+
+    // The odometer only accepts the characters of each position.
+    CandidateOdometer odometer(*mask);
+    EXPECT_TRUE(odometer.set("Z9"));
+    EXPECT_FALSE(odometer.set("9Z"));
+    EXPECT_FALSE(odometer.set("A0aA"));
+}
+
+TEST(Wordlist, byte_ranges)
+{
+    const auto path = testing::TempDir() + "wordlist_byte_ranges.txt";
+    std::ofstream(path, std::ios::binary) << "password\r\n\nabc\n" << std::string(60, 'x') << "\nz";
+
+    auto wordlist = Wordlist::open(path);
+    ASSERT_TRUE(wordlist);
+    EXPECT_EQ(wordlist->size(), 77);
+    EXPECT_EQ(wordlist->get_word_begin(0), 0);
+    EXPECT_EQ(wordlist->get_word_begin(1), 10);
+    EXPECT_EQ(wordlist->get_word_begin(10), 10);
+    EXPECT_EQ(wordlist->get_word_begin(11), 11);
+    EXPECT_EQ(wordlist->get_word_begin(76), 76);
+    EXPECT_EQ(wordlist->get_word_begin(77), 77);
+    EXPECT_FALSE(Wordlist::open(testing::TempDir() + "missing_wordlist.txt"));
+
+    // Any split into byte ranges hashes each word once, the word too long for a single block too.
+    const std::vector<std::string> words = {"password", "abc", std::string(60, 'x'), "z"};
+    HashGenerator single_generator("IEEE", "Xtreme", wordlist);
+    ASSERT_TRUE(single_generator.set_next_index(0));
+    std::vector<Sha256Engine::Digest> hashes;
+    for (const auto &word : words) {
+        hashes.push_back(single_generator.get_next_permutation_hash());
+        EXPECT_EQ(single_generator.get_current_permutation(), word);
+    }
+
+    HashGenerator batch_generator("IEEE", "Xtreme", wordlist);
+    sHashBatch batch;
+    for (uint64_t split = 0; split <= wordlist->size(); ++split) {
+        size_t word_index = 0;
+        for (auto [begin, end] : {std::pair<uint64_t, uint64_t>{0, split}, {split, 77}}) {
+            ASSERT_TRUE(batch_generator.set_next_index(begin));
+            while (batch_generator.get_next_index() < end) {
+                batch_generator.next_hashes(batch, end - batch_generator.get_next_index());
+                for (size_t i = 0; i < batch.size; ++i, ++word_index) {
+                    ASSERT_LT(word_index, words.size());
+                    EXPECT_EQ(batch.permutations[i], words[word_index]);
+                    EXPECT_EQ(batch.hashes[i], hashes[word_index]);
+                }
+            }
+        }
+        EXPECT_EQ(word_index, words.size()) << split;
+    }
+}
+
+TEST(HashGenerator, hybrid)
+{
+    const auto path = testing::TempDir() + "hybrid_wordlist.txt";
+    const std::string long_word(44, 'x');
+    std::ofstream(path, std::ios::binary) << "abc\n\npassword\r\n" << long_word << "\nz";
+    auto wordlist = Wordlist::open(path);
+    ASSERT_TRUE(wordlist);
+    const std::vector<std::pair<uint64_t, std::string>> words = {
+        {0, "abc"}, {5, "password"}, {15, long_word}, {60, "z"}};
+
+    // 10 + 10 * 2 mask candidates. The long word fits in a single block with a single character.
+    const auto mask = Mask::parse("?d?1", {"ab"});
+    ASSERT_TRUE(mask);
+    const Keyspace keyspace(*mask, 1, 2);
+    ASSERT_EQ(keyspace.size(), 30);
+
+    for (auto mask_position :
+        {HashGenerator::eMaskPosition::APPEND, HashGenerator::eMaskPosition::PREPEND}) {
+        // The permutations and their indices, in the order they are generated.
+        std::vector<std::pair<uint64_t, std::string>> permutations;
+        for (const auto &[offset, word] : words) {
+            for (uint64_t i = 0; i < keyspace.size(); ++i) {
+                const auto mask_candidate = *keyspace.get_candidate(i);
+                permutations.emplace_back(offset * keyspace.size() + i,
+                    mask_position == HashGenerator::eMaskPosition::APPEND ? word + mask_candidate
+                                                                          : mask_candidate + word);
+            }
+        }
+
+        HashGenerator single_generator("IEEE", "Xtreme", wordlist, *mask, 1, 2, mask_position);
+        ASSERT_EQ(single_generator.get_end_index(), wordlist->size() * keyspace.size());
+        ASSERT_TRUE(single_generator.set_next_index(0));
+        std::vector<Sha256Engine::Digest> hashes;
+        for (const auto &[index, permutation] : permutations) {
+            hashes.push_back(single_generator.get_next_permutation_hash());
+            EXPECT_EQ(single_generator.get_current_permutation(), permutation);
+            EXPECT_EQ(single_generator.get_candidate(index), permutation);
+        }
+        // An index between words is before the first permutation of the next word.
+        EXPECT_EQ(single_generator.get_candidate(1 * keyspace.size() + 3), permutations[30].second);
+        EXPECT_FALSE(single_generator.get_candidate(single_generator.get_end_index()));
+
+        // Any split of the indices, within a word or between words, generates each permutation
+        // once, in order.
+        HashGenerator batch_generator("IEEE", "Xtreme", wordlist, *mask, 1, 2, mask_position);
+        sHashBatch batch;
+        const auto end_index = batch_generator.get_end_index();
+        for (uint64_t split = 0; split <= end_index; split += 7) {
+            size_t permutation_index = 0;
+            const std::pair<uint64_t, uint64_t> ranges[] = {{0, split}, {split, end_index}};
+            for (auto [begin, end] : ranges) {
+                ASSERT_TRUE(batch_generator.set_next_index(begin));
+                while (batch_generator.get_next_index() < end) {
+                    batch_generator.next_hashes(batch, end - batch_generator.get_next_index());
+                    for (size_t i = 0; i < batch.size; ++i, ++permutation_index) {
+                        ASSERT_LT(permutation_index, permutations.size());
+                        EXPECT_EQ(batch.permutations[i], permutations[permutation_index].second);
+                        EXPECT_EQ(batch.hashes[i], hashes[permutation_index]);
+                    }
+                }
+            }
+            EXPECT_EQ(permutation_index, permutations.size()) << split;
+        }
+    }
+}
+
+TEST(HashGenerator, combinator)
+{
+    const auto left_path  = testing::TempDir() + "combinator_left_wordlist.txt";
+    const auto right_path = testing::TempDir() + "combinator_right_wordlist.txt";
+    const std::string long_left_word(40, 'x');
+    const std::string long_right_word(20, 'y');
+    std::ofstream(left_path, std::ios::binary) << "abc\n\npassword\r\n" << long_left_word << "\nz";
+    std::ofstream(right_path, std::ios::binary) << "1\n\n123\n" << long_right_word << "\n!";
+    auto left_wordlist  = Wordlist::open(left_path);
+    auto right_wordlist = Wordlist::open(right_path);
+    ASSERT_TRUE(left_wordlist);
+    ASSERT_TRUE(right_wordlist);
+    const std::vector<std::pair<uint64_t, std::string>> left_words = {
+        {0, "abc"}, {5, "password"}, {15, long_left_word}, {56, "z"}};
+    const std::vector<std::pair<uint64_t, std::string>> right_words = {
+        {0, "1"}, {3, "123"}, {7, long_right_word}, {28, "!"}};
+
+    // The permutations and their indices, in the order they are generated. The long words together
+    // don't fit in a single block.
+    std::vector<std::pair<uint64_t, std::string>> permutations;
+    for (const auto &[left_offset, left_word] : left_words) {
+        for (const auto &[right_offset, right_word] : right_words) {
+            permutations.emplace_back(
+                left_offset * right_wordlist->size() + right_offset, left_word + right_word);
+        }
+    }
+
+    HashGenerator single_generator("IEEE", "Xtreme", left_wordlist, right_wordlist);
+    ASSERT_EQ(single_generator.get_end_index(), left_wordlist->size() * right_wordlist->size());
+    ASSERT_TRUE(single_generator.set_next_index(0));
+    std::vector<Sha256Engine::Digest> hashes;
+    for (const auto &[index, permutation] : permutations) {
+        hashes.push_back(single_generator.get_next_permutation_hash());
+        EXPECT_EQ(single_generator.get_current_permutation(), permutation);
+        EXPECT_EQ(single_generator.get_candidate(index), permutation);
+    }
+    // An index between left words is before the first permutation of the next left word.
+    EXPECT_EQ(single_generator.get_candidate(right_wordlist->size() + 3), permutations[4].second);
+    EXPECT_FALSE(single_generator.get_candidate(single_generator.get_end_index()));
+
+    // Any split of the indices, within the right words or between left words, generates each
+    // permutation once, in order.
+    HashGenerator batch_generator("IEEE", "Xtreme", left_wordlist, right_wordlist);
+    sHashBatch batch;
+    const auto end_index = batch_generator.get_end_index();
+    for (uint64_t split = 0; split <= end_index; ++split) {
+        size_t permutation_index = 0;
+        const std::pair<uint64_t, uint64_t> ranges[] = {{0, split}, {split, end_index}};
+        for (auto [begin, end] : ranges) {
+            ASSERT_TRUE(batch_generator.set_next_index(begin));
+            while (batch_generator.get_next_index() < end) {
+                batch_generator.next_hashes(batch, end - batch_generator.get_next_index());
+                for (size_t i = 0; i < batch.size; ++i, ++permutation_index) {
+                    ASSERT_LT(permutation_index, permutations.size());
+                    EXPECT_EQ(batch.permutations[i], permutations[permutation_index].second);
+                    EXPECT_EQ(batch.hashes[i], hashes[permutation_index]);
+                }
+            }
+        }
+        EXPECT_EQ(permutation_index, permutations.size()) << split;
+    }
+}
+
+TEST(RuleSet, apply)
+{
+    const std::string x(60, 'x'), y(64, 'y');
+    RuleSet::sWordBatch words;
+    for (const auto &word : {std::string("password"), std::string("Abc1"), x, y}) {
+        ASSERT_TRUE(words.add(word));
+    }
+    EXPECT_FALSE(words.add(y + "y"));
+
+    // Each rule and its candidates, empty for a rejected word. The invalid rules are left out.
+    const std::vector<std::pair<std::string, std::vector<std::string>>> rules = {
+        {":", {"password", "Abc1", x, y}},
+        {"c $1", {"Password1", "Abc11", "X" + x.substr(1) + "1", ""}},
+        {"x", {}},
+        {"u", {"PASSWORD", "ABC1", std::string(60, 'X'), std::string(64, 'Y')}},
+        {"sa@ so0", {"p@ssw0rd", "Abc1", x, y}},
+        {"sa@ s@4 so0 sd! sx+", {"p4ssw0r!", "Abc1", std::string(60, '+'), y}},
+        {"d", {"passwordpassword", "Abc1Abc1", "", ""}},
+        {"$", {}},
+        {"'3", {"pas", "Abc", "xxx", "yyy"}},
+        {"[ ]", {"asswor", "bc", x.substr(2), y.substr(2)}},
+        {"T0 T2", {"PaSsword", "abC1", "XxX" + x.substr(3), "YyY" + y.substr(3)}},
+        {"sa", {}},
+        {"^x", {"xpassword", "xAbc1", x + "x", ""}},
+        {"$1 $2 $3 $4", {"password1234", "Abc11234", x + "1234", ""}},
+        {"$1 $2 $3 $4 $5 $6 $7 $8", {"password12345678", "Abc112345678", "", ""}},
+        {"T*", {}},
+        {"C", {"pASSWORD", "aBC1", "x" + std::string(59, 'X'), "y" + std::string(63, 'Y')}},
+        {"t", {"PASSWORD", "aBC1", std::string(60, 'X'), std::string(64, 'Y')}},
+        {"p2 l", {"passwordpasswordpassword", "abc1abc1abc1", "", ""}},
+    };
+
+    std::vector<std::string> rule_strings;
+    std::vector<std::vector<std::string>> expected_candidates;
+    for (const auto &[rule, candidates] : rules) {
+        rule_strings.push_back(rule);
+        if (!candidates.empty()) {
+            expected_candidates.push_back(candidates);
+        }
+    }
+    const auto rule_set = RuleSet::parse(rule_strings);
+    ASSERT_TRUE(rule_set);
+    ASSERT_EQ(rule_set->size(), expected_candidates.size());
+
+    RuleSet::sWordBatch candidates;
+    for (size_t rule_index = 0; rule_index < rule_set->size(); ++rule_index) {
+        rule_set->apply(rule_index, words, candidates);
+        ASSERT_EQ(candidates.size, words.size);
+        for (size_t i = 0; i < candidates.size; ++i) {
+            EXPECT_EQ(candidates.get(i), expected_candidates[rule_index][i]) << rule_index;
+        }
+    }
+
+    EXPECT_FALSE(RuleSet::parse({"x", "^"}));
+    EXPECT_FALSE(RuleSet::load(testing::TempDir() + "missing_rules.txt"));
+}
+
+TEST(RuleSet, wordlist_byte_ranges)
+{
+    const auto path = testing::TempDir() + "rules_byte_ranges.txt";
+    std::ofstream(path, std::ios::binary) << "password\nabc\r\n\n" << std::string(62, 'x') << "\nz";
+    auto wordlist = Wordlist::open(path);
+    ASSERT_TRUE(wordlist);
+    auto rules = std::make_shared<RuleSet>(*RuleSet::parse({":", "$1 $2 $3", "u"}));
+
+    // All the rules are applied to a window of words, the rejected candidates are skipped.
+    const std::vector<std::string> candidates = {"password", "abc", std::string(62, 'x'), "z",
+        "password123", "abc123", "z123", "PASSWORD", "ABC", std::string(62, 'X'), "Z"};
+    HashGenerator single_generator("IEEE", "Xtreme", wordlist, rules);
+    ASSERT_TRUE(single_generator.set_next_index(0));
+    std::map<std::string, Sha256Engine::Digest> hashes;
+    for (const auto &candidate : candidates) {
+        const auto hash = single_generator.get_next_permutation_hash();
+        EXPECT_EQ(single_generator.get_current_permutation(), candidate);
+        hashes[candidate] = hash;
+    }
+
+    // Any split into byte ranges hashes each candidate once, in the order of its own windows.
+    const std::multiset<std::string> expected_candidates(candidates.begin(), candidates.end());
+    HashGenerator batch_generator("IEEE", "Xtreme", wordlist, rules);
+    sHashBatch batch;
+    for (uint64_t split = 0; split <= wordlist->size(); ++split) {
+        std::multiset<std::string> hashed_candidates;
+        const auto end_index = wordlist->size();
+        for (auto [begin, end] : {std::pair<uint64_t, uint64_t>{0, split}, {split, end_index}}) {
+            ASSERT_TRUE(batch_generator.set_next_index(begin));
+            while (batch_generator.get_next_index() < end) {
+                batch_generator.next_hashes(batch, end - batch_generator.get_next_index());
+                for (size_t i = 0; i < batch.size; ++i) {
+                    const std::string candidate(batch.permutations[i]);
+                    ASSERT_TRUE(hashes.count(candidate)) << candidate;
+                    EXPECT_EQ(batch.hashes[i], hashes[candidate]);
+                    hashed_candidates.insert(candidate);
+                }
+            }
+        }
+        EXPECT_EQ(hashed_candidates, expected_candidates) << split;
+    }
+}
+
+TEST(KeyspaceScheduler, next_chunk)
+{
+    constexpr uint64_t begin_index = 1000;
+    constexpr uint64_t end_index   = 1000000;
+    constexpr size_t workers_count = 4;
+    Keyspace keyspace("0123456789abcdefghijklmnopqrstuvwxyz");
+    for (auto distribution : {KeyspaceScheduler::eDistribution::CONTIGUOUS,
+             KeyspaceScheduler::eDistribution::LENGTH_MAJOR}) {
+        KeyspaceScheduler scheduler(keyspace, begin_index, end_index, workers_count, distribution);
+        EXPECT_EQ(scheduler.size(), end_index - begin_index);
+
+        // Each worker marks the indices of its chunks. The last worker is slow, its range is
+        // stolen.
+        std::vector<std::atomic<uint8_t>> taken_counts(end_index);
+        auto work = [&](size_t worker_index) {
+            while (auto chunk = scheduler.next_chunk(worker_index, 1000)) {
+                ASSERT_LE(begin_index, chunk->begin);
+                ASSERT_LT(chunk->begin, chunk->end);
+                ASSERT_LE(chunk->end, end_index);
+                for (auto index = chunk->begin; index < chunk->end; ++index) {
+                    ++taken_counts[index];
+                }
+                if (worker_index == workers_count - 1) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                scheduler.complete_chunk(*chunk);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t worker_index = 0; worker_index < workers_count; ++worker_index) {
+            threads.emplace_back(work, worker_index);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+
+        EXPECT_TRUE(scheduler.is_done());
+        EXPECT_GT(scheduler.get_steals_count(), 0);
+        for (uint64_t index = 0; index < end_index; ++index) {
+            ASSERT_EQ(taken_counts[index], index < begin_index ? 0 : 1) << index;
+        }
+    }
+
+    EXPECT_FALSE(KeyspaceScheduler(keyspace, 10, 10, 2).next_chunk(1, 1));
+}
+
+TEST(KeyspaceScheduler, length_major_distribution)
+{
+    // Lengths 1 to 3 of "abc": [0, 3), [3, 12), [12, 39).
+    Keyspace keyspace("abc");
+    using Chunk     = std::pair<uint64_t, uint64_t>;
+    using Chunks    = std::vector<Chunk>;
+    auto next_chunk = [](KeyspaceScheduler &scheduler, size_t worker_index) {
+        auto chunk = scheduler.next_chunk(worker_index, 100);
+        if (!chunk) {
+            return Chunk();
+        }
+        scheduler.complete_chunk(*chunk);
+        return Chunk(chunk->begin, chunk->end);
+    };
+
+    // Each worker has its share of each length. When the workers keep pace, they all take their
+    // share of a length before the next length.
+    KeyspaceScheduler scheduler(
+        keyspace, 1, 39, 3, KeyspaceScheduler::eDistribution::LENGTH_MAJOR);
+    Chunks chunks;
+    for (int round = 0; round < 3; ++round) {
+        for (size_t worker_index = 0; worker_index < 3; ++worker_index) {
+            chunks.push_back(next_chunk(scheduler, worker_index));
+        }
+    }
+    EXPECT_EQ(chunks, Chunks({{1, 2}, {2, 3}, {9, 12}, {3, 6}, {6, 9}, {30, 39}, {12, 21},
+                          {21, 30}, {0, 0}}));
+    EXPECT_TRUE(scheduler.is_done());
+    EXPECT_EQ(scheduler.get_steals_count(), 0);
+
+    // A worker which is done with its share of a length helps with the rest of the length, from
+    // the shortest, before it moves to its share of the next length.
+    KeyspaceScheduler stealing_scheduler(
+        keyspace, 1, 39, 3, KeyspaceScheduler::eDistribution::LENGTH_MAJOR);
+    EXPECT_EQ(next_chunk(stealing_scheduler, 0), Chunk(1, 2));
+    EXPECT_EQ(next_chunk(stealing_scheduler, 0), Chunk(2, 3));
+    EXPECT_EQ(next_chunk(stealing_scheduler, 1), Chunk(6, 9));
+    EXPECT_EQ(next_chunk(stealing_scheduler, 0), Chunk(3, 6));
+    EXPECT_EQ(next_chunk(stealing_scheduler, 0), Chunk(10, 12));
+    EXPECT_EQ(next_chunk(stealing_scheduler, 2), Chunk(9, 10));
+    EXPECT_EQ(stealing_scheduler.get_steals_count(), 2);
+
+    // The rest is length 3, and nothing is taken twice.
+    std::vector<uint8_t> taken_counts(39);
+    for (size_t worker_index = 0; worker_index < 3; ++worker_index) {
+        while (true) {
+            const auto [begin, end] = next_chunk(stealing_scheduler, worker_index);
+            if (begin == end) {
+                break;
+            }
+            EXPECT_EQ(keyspace.get_candidate_size(begin), 3);
+            for (auto index = begin; index < end; ++index) {
+                ++taken_counts[index];
+            }
+        }
+    }
+    EXPECT_TRUE(stealing_scheduler.is_done());
+    EXPECT_EQ(std::count(taken_counts.begin(), taken_counts.end(), 1), 39 - 12);
+}
+
+TEST(PollingScheduler, deadlines)
+{
+    PollingScheduler scheduler;
+    std::vector<int> runs(3);
+    scheduler.schedule_task("every poll", [&]() { ++runs[0]; }, std::chrono::milliseconds(0));
+    scheduler.schedule_task("short", [&]() { ++runs[1]; }, std::chrono::milliseconds(50));
+    scheduler.schedule_task("long", [&]() { ++runs[2]; }, std::chrono::hours(1));
+
+    // The tasks are due when they are scheduled, then once per time cycle, at most once per poll.
+    scheduler.poll();
+    EXPECT_EQ(runs, std::vector<int>({1, 1, 1}));
+    scheduler.poll();
+    EXPECT_EQ(runs, std::vector<int>({2, 1, 1}));
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    scheduler.poll();
+    scheduler.poll();
+    EXPECT_EQ(runs, std::vector<int>({4, 2, 1}));
+}
+
+TEST(ThreadMessageIO, transports)
+{
+    struct sSequenceMessage : MsgBase {
+        sSequenceMessage(uint64_t sequence_) : MsgBase(0), sequence(sequence_) {}
+        uint64_t sequence;
+    };
+    constexpr uint64_t messages_count = 10 * sMessageChannel::ring_buffer_capacity;
+    std::vector<uint64_t> sequences(3 * messages_count);
+    std::iota(sequences.begin(), sequences.end(), 0);
+
+    for (auto transport : {eMessageTransport::MUTEX_QUEUES, eMessageTransport::SPSC_RING_BUFFERS}) {
+        ThreadMessageIO io(transport);
+        auto &internal_endpoint = io.get_internal_endpoint();
+        auto &external_endpoint = io.get_external_endpoint();
+        std::vector<uint64_t> received;
+        external_endpoint.register_message_handler(0, [&](const MsgBase &message) {
+            received.push_back(static_cast<const sSequenceMessage &>(message).sequence);
+        });
+
+        // More messages than a ring buffer holds, sent before any is handled, keep their order.
+        for (uint64_t i = 0; i < messages_count; ++i) {
+            internal_endpoint.send_message_thread_safe(sSequenceMessage(i));
+        }
+        external_endpoint.handle_messages_thread_safe();
+        ASSERT_EQ(received.size(), messages_count);
+
+        // So do the messages of a concurrent sender.
+        std::thread sender([&]() {
+            for (uint64_t i = messages_count; i < sequences.size(); ++i) {
+                internal_endpoint.send_message_thread_safe(sSequenceMessage(i));
+            }
+        });
+        while (received.size() < sequences.size()) {
+            external_endpoint.handle_messages_thread_safe();
+            std::this_thread::yield();
+        }
+        sender.join();
+        EXPECT_EQ(received, sequences);
+    }
+}
+
+TEST(ThreadMessageIO, overflow_order)
+{
+    struct sSequenceMessage : MsgBase {
+        sSequenceMessage(uint64_t sequence_) : MsgBase(0), sequence(sequence_) {}
+        uint64_t sequence;
+    };
+    constexpr uint64_t messages_count = sMessageChannel::ring_buffer_capacity - 1;
+    std::vector<uint64_t> sequences(messages_count + 2);
+    std::iota(sequences.begin(), sequences.end(), 0);
+
+    for (auto transport : {eMessageTransport::MUTEX_QUEUES, eMessageTransport::SPSC_RING_BUFFERS}) {
+        ThreadMessageIO io(transport);
+        auto &internal_endpoint = io.get_internal_endpoint();
+        auto &external_endpoint = io.get_external_endpoint();
+
+        // While the first message is handled, the sender fills the last slot of the ring buffer,
+        // which is not released yet, and queues the next message.
+        std::vector<uint64_t> received;
+        external_endpoint.register_message_handler(0, [&](const MsgBase &message) {
+            if (received.empty()) {
+                std::thread sender([&]() {
+                    internal_endpoint.send_message_thread_safe(sSequenceMessage(messages_count));
+                    internal_endpoint.send_message_thread_safe(
+                        sSequenceMessage(messages_count + 1));
+                });
+                sender.join();
+            }
+            received.push_back(static_cast<const sSequenceMessage &>(message).sequence);
+        });
+
+        for (uint64_t i = 0; i < messages_count; ++i) {
+            internal_endpoint.send_message_thread_safe(sSequenceMessage(i));
+        }
+        external_endpoint.handle_messages_thread_safe();
+        external_endpoint.handle_messages_thread_safe();
+        EXPECT_EQ(received, sequences);
+    }
+}
+
+TEST(ThreadMessageIO, dispatch)
+{
+    struct sTypedMessage : MsgBase {
+        sTypedMessage(uint16_t message_type_) : MsgBase(message_type_) {}
+    };
+    constexpr uint16_t last_type = MsgEndPoint::max_message_types - 1;
+    constexpr uint16_t out_of_table_type = MsgEndPoint::max_message_types;
+
+    ThreadMessageIO io;
+    auto &internal_endpoint = io.get_internal_endpoint();
+    auto &external_endpoint = io.get_external_endpoint();
+
+    // Each message goes to the handler of its type, a second handler of a type and a type out of
+    // the table are ignored.
+    std::vector<uint16_t> received;
+    for (uint16_t message_type : std::vector<uint16_t>({0, 3, last_type})) {
+        external_endpoint.register_message_handler(
+            message_type, [&, message_type](const MsgBase &) { received.push_back(message_type); });
+    }
+    external_endpoint.register_message_handler(3, [&](const MsgBase &) { received.push_back(0); });
+    external_endpoint.register_message_handler(
+        out_of_table_type, [&](const MsgBase &) { received.push_back(0); });
+
+    const std::vector<uint16_t> sent = {3, 0, last_type, 1, 3, out_of_table_type, 0};
+    for (auto message_type : sent) {
+        internal_endpoint.send_message(sTypedMessage(message_type));
+    }
+    external_endpoint.handle_messages();
+    EXPECT_EQ(received, std::vector<uint16_t>({3, 0, last_type, 3, 0}));
+}
+
+TEST(ThreadMessageIO, wakeup)
+{
+    struct sWakeupMessage : MsgBase {
+        sWakeupMessage() : MsgBase(0) {}
+    };
+    for (auto transport : {eMessageTransport::MUTEX_QUEUES, eMessageTransport::SPSC_RING_BUFFERS}) {
+        ThreadMessageIO io(transport);
+        auto &internal_endpoint = io.get_internal_endpoint();
+        auto &external_endpoint = io.get_external_endpoint();
+        int received            = 0;
+        internal_endpoint.register_message_handler(0, [&](const MsgBase &) { ++received; });
+
+        // With no message, the wait times out.
+        EXPECT_FALSE(internal_endpoint.has_pending_messages());
+        auto start = std::chrono::steady_clock::now();
+        internal_endpoint.wait_for_messages(std::chrono::milliseconds(20));
+        EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+        // The pending flag is set until the messages are handled.
+        external_endpoint.send_message_thread_safe(sWakeupMessage());
+        EXPECT_TRUE(internal_endpoint.has_pending_messages());
+        internal_endpoint.handle_messages_thread_safe();
+        EXPECT_FALSE(internal_endpoint.has_pending_messages());
+        EXPECT_EQ(received, 1);
+
+        // An idle thread wakes up when a message is sent, long before its timeout.
+        std::thread handler([&]() {
+            while (received == 1) {
+                internal_endpoint.wait_for_messages(std::chrono::seconds(60));
+                internal_endpoint.handle_messages_thread_safe();
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        start = std::chrono::steady_clock::now();
+        external_endpoint.send_message_thread_safe(sWakeupMessage());
+        handler.join();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+        EXPECT_EQ(received, 2);
+
+        // A wake up ends the wait too, with no message to handle.
+        std::thread waiter(
+            [&]() { internal_endpoint.wait_for_messages(std::chrono::seconds(60)); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        start = std::chrono::steady_clock::now();
+        external_endpoint.wake_up();
+        waiter.join();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(10));
+        internal_endpoint.handle_messages_thread_safe();
+        EXPECT_FALSE(internal_endpoint.has_pending_messages());
+        EXPECT_EQ(received, 2);
+    }
 }
 
 TEST(BaseOperationsUtils, decimal_to_base_x)
@@ -120,6 +1129,11 @@ TEST(BaseOperationsUtils, increment_base_x_integer)
     str.assign("ff");
     BaseOperationsUtils::increment_base_x_integer(str, bc16);
     EXPECT_STREQ(str.c_str(), "100");
+
+    // The leading digit 1 is the second base character.
+    str.assign("cc");
+    BaseOperationsUtils::increment_base_x_integer(str, "abc");
+    EXPECT_STREQ(str.c_str(), "baa");
 }
 
 TEST(UiUtils, build_hash_rate_string)